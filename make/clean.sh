@@ -2,3 +2,4 @@ make -f nonogram.make clean
 make -f nonogram_debug.make clean
 make -f nonogram_pg.make clean
 make -f convert_bitmap.make clean
+make -f nonogram_pack.make clean
@@ -2,3 +2,4 @@ make -f nonogram.make
 make -f nonogram_debug.make
 make -f nonogram_pg.make
 make -f convert_bitmap.make
+make -f nonogram_pack.make
@@ -8,7 +8,7 @@ ls nonogram_*.txt | (
 	while [ "${FILENAME}" ]
 	do
 		echo "Solving ${FILENAME}..."
-		time timeout $1 ../../bin/nonogram 0 $2 <$FILENAME
+		time ../../bin/nonogram -t $1 0 $2 <$FILENAME
 		read FILENAME
 	done
 )
@@ -11,7 +11,7 @@ do
 	if [ $? -eq 0 ]
 	then
 		echo "Solving ${FILENAME}..."
-		time timeout 120 ../../bin/nonogram 0 2 <${FILENAME}
+		time ../../bin/nonogram -t 120 0 2 <${FILENAME}
 	fi
 	rm -f ${FILENAME}
 	let PUZZLE_ID=$PUZZLE_ID+1
@@ -3,7 +3,7 @@ cat puzzles.txt | (
 	while [ "${FILENAME}" ]
 	do
 		echo "Solving ${FILENAME}..."
-		time timeout 1800 ../../bin/nonogram 0 2 <../../puzzles/${FILENAME}
+		time ../../bin/nonogram -t 1800 0 2 <../../puzzles/${FILENAME}
 		read FILENAME
 	done
 )
@@ -14,7 +14,7 @@ ls rand* | (
 	while [ "${FILENAME}" ]
 	do
 		echo "Solving ${FILENAME}..."
-		time ../../../bin/convert_bitmap 30 30 <$FILENAME | timeout 120 ../../../bin/nonogram 0 2
+		time ../../../bin/convert_bitmap 30 30 <$FILENAME | ../../../bin/nonogram -t 120 0 2
 		read FILENAME
 	done
 )
@@ -0,0 +1,47 @@
+FAILURES=0
+cat puzzles.txt | (
+	read FILENAME SOLUTIONS
+	while [ "${FILENAME}" ]
+	do
+		for STRATEGY in probe adaptive top fewest
+		do
+			case ${STRATEGY} in
+			top)
+				BUDGETS="none 1 2"
+				STRATEGY_OPTIONS="-s top -k 2"
+				;;
+			fewest)
+				BUDGETS="none"
+				STRATEGY_OPTIONS="-s fewest"
+				;;
+			*)
+				BUDGETS="none 1 2"
+				STRATEGY_OPTIONS="-s ${STRATEGY}"
+				;;
+			esac
+			for SEED in 0 7
+			do
+				for BUDGET in ${BUDGETS}
+				do
+					OPTIONS="${STRATEGY_OPTIONS} -S ${SEED}"
+					if [ ${BUDGET} != none ]
+					then
+						OPTIONS="${OPTIONS} -e ${BUDGET}"
+					fi
+					for JOBS in 1 2 4
+					do
+						RESULT=`../../bin/nonogram ${OPTIONS} -j ${JOBS} 0 <../../puzzles/${FILENAME} | grep "^Solutions "`
+						if [ "${RESULT}" != "Solutions ${SOLUTIONS}" ]
+						then
+							echo "${FILENAME} ${OPTIONS} -j ${JOBS}: ${RESULT} instead of ${SOLUTIONS}"
+							let FAILURES=$FAILURES+1
+						fi
+					done
+				done
+			done
+		done
+		read FILENAME SOLUTIONS
+	done
+	echo "Failures ${FAILURES}"
+	test ${FAILURES} -eq 0
+)
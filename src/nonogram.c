@@ -1,1271 +1,705 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <errno.h>
 #include <limits.h>
+#include <string.h>
 #include <time.h>
-
-#define SEPARATOR_CLUES ','
-#define SEPARATOR_LINES '\n'
-#define DELIMITER_CLUE '\"'
-#define SEPARATOR_COLOR '-'
-#define SEPARATOR_SETS ','
-#define COLOR_UNKNOWN '?'
-#define COLOR_SEVERAL '!'
-#define COLOR_EMPTY ' '
-#define COLOR_BLACK '*'
-#define COLOR_POS_UNKNOWN 0
-#define COLOR_POS_SEVERAL 1
-#define COLOR_POS_EMPTY 2
-#define COLOR_POS_BLACK 3
-#define DEPTH_CUR 0
-#define DEPTH_BCK 1
-#define DEPTHS_SIZE 2
-#define CACHE_UNKNOWN 0
-#define CACHE_CONFIRMED 1
-
-typedef struct {
-	int pos;
-	int r;
-	int changes_sum;
-}
-option_t;
-
-typedef struct set_s set_t;
-typedef struct clue_s clue_t;
-typedef struct cell_s cell_t;
-
-struct set_s {
-	int len;
-	int color_pos;
-	clue_t *clue;
-	int empty_before;
-	int *empty_bounds_min;
-	int *color_bounds_min;
-	int *color_bounds_max;
-	int *empty_cache;
-	int *color_cache;
-	int options_n;
-	option_t *options;
-	int solutions_n;
-	int changes_sum;
-	int skipped;
-	int others_n;
-	set_t *last;
-	set_t *next;
+#include <stdint.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "nonogram_solver.h"
+
+#define WORKERS_MAX 256
+#define NOGOODS_MAX 16777216UL
+#define FILENAME_SIZE 4096
+#define FORMAT_TEXT 0
+#define FORMAT_JSON 1
+#define FORMAT_CSV 2
+#define MEGABYTE 1048576UL
+#define STRATEGIES_N 4
+#define INPUT_BLOCK MEGABYTE
+#define ANSWER_NONE 0
+#define ANSWER_UNIQUE 1
+#define ANSWER_MULTIPLE 2
+#define ANSWER_UNKNOWN 3
+
+/* Exit codes of the unique mode, EXIT_FAILURE is kept for the errors. */
+#define EXIT_MULTIPLE 2
+#define EXIT_NONE 3
+#define EXIT_UNKNOWN 4
+
+static void usage(const char *);
+static int solve_batch(nonogram_t *, const char *);
+static int solve_stream(nonogram_t *, unsigned long *);
+static int solve_list(nonogram_t *, const char *, unsigned long *);
+static int solve_file(nonogram_t *, const char *, unsigned long *);
+static int solve_pack(nonogram_t *, const char *, const unsigned char *, size_t, unsigned long *);
+static uint64_t read_uint(const unsigned char *, int);
+static char *read_input(FILE *, size_t *);
+static int solve_puzzle(nonogram_t *, const char *, int);
+static void print_failure(const char *, const char *);
+static size_t skip_blanks(const char *, size_t, size_t);
+static int print_solution(void *, const nonogram_stats_t *, const char *);
+static void print_record(const char *, const nonogram_stats_t *, const char *);
+static void print_json_string(const char *);
+static void print_csv_string(const char *);
+static void print_partial_grid(nonogram_t *, const nonogram_stats_t *);
+static int get_answer(const nonogram_stats_t *);
+
+static int width, height, colors_n, batch, format;
+static unsigned long pack_puzzle;
+static const char *puzzle_name;
+static nonogram_options_t options;
+static const char *aborted_names[] = { "none", "nodes", "time", "memory" };
+static const char *strategy_names[STRATEGIES_N] = { "probe", "fewest", "top", "adaptive" };
+static const char *answer_names[] = { "none", "unique", "multiple", "unknown" };
+static const int answer_codes[] = { EXIT_NONE, EXIT_SUCCESS, EXIT_MULTIPLE, EXIT_UNKNOWN };
+
+static const struct option long_options[] = {
+	{ "jobs", required_argument, NULL, 'j' },
+	{ "batch", optional_argument, NULL, 'b' },
+	{ "profile", no_argument, NULL, 'p' },
+	{ "format", required_argument, NULL, 'f' },
+	{ "nodes", required_argument, NULL, 'n' },
+	{ "time", required_argument, NULL, 't' },
+	{ "memory", required_argument, NULL, 'm' },
+	{ "checkpoint", required_argument, NULL, 'c' },
+	{ "interval", required_argument, NULL, 'i' },
+	{ "resume", required_argument, NULL, 'r' },
+	{ "hash", required_argument, NULL, 'H' },
+	{ "strategy", required_argument, NULL, 's' },
+	{ "probes", required_argument, NULL, 'k' },
+	{ "budget", required_argument, NULL, 'e' },
+	{ "puzzle", required_argument, NULL, 'x' },
+	{ "portfolio", required_argument, NULL, 'P' },
+	{ "seed", required_argument, NULL, 'S' },
+	{ "restarts", required_argument, NULL, 'R' },
+	{ "nogoods", required_argument, NULL, 'G' },
+	{ "unique", no_argument, NULL, 'u' },
+	{ NULL, 0, NULL, 0 }
 };
 
-struct clue_s {
-	int pos;
-	int sets_n;
-	set_t *sets;
-	set_t *sets_header;
-	int depths_size;
-	int priority;
-	cell_t *cells_header;
-	clue_t *last;
-	clue_t *next;
-};
-
-struct cell_s {
-	clue_t *column_clue;
-	clue_t *row_clue;
-	int color_pos;
-	int *color_cache;
-	cell_t *column_last;
-	cell_t *column_next;
-	cell_t *row_last;
-	cell_t *row_next;
-};
-
-static int read_clue(clue_t *, int, int);
-static void init_set_fields(set_t *, int, int, clue_t *);
-static int init_set_tables(set_t *, int, int, int, int);
-static void link_set(set_t *, set_t *, set_t *);
-static void link_clue(clue_t *, clue_t *, clue_t *);
-static int init_cell(cell_t *, clue_t *, clue_t *);
-static void link_column_clue(clue_t *, cell_t *);
-static void link_column_cell(cell_t *, cell_t *, cell_t *);
-static void link_row_clue(clue_t *, cell_t *);
-static void link_row_cell(cell_t *, cell_t *, cell_t *);
-static void nonogram(clue_t *, option_t *);
-static void init_option(option_t *, int, int);
-static int reallocate_bounds(set_t *, int);
-static int compare_priorities(const void *, const void *);
-static int sweep_clue(set_t *, int, cell_t *);
-static int sweep_set(set_t *, int, cell_t *, cell_t **, int *);
-static int check_cell_colors(cell_t *);
-static void update_empty_bound_and_cache(int *, const int *, int *);
-static void update_color_bounds_and_cache(int *, int *, int *);
-static void clear_set_positive_cache(const int *, const int *, int *);
-static int compare_sets(const void *, const void *);
-static int evaluate_set(set_t *);
-static void evaluate_option(set_t *, option_t *);
-static set_t *init_set_min(set_t *);
-static int compare_evaluations(const set_t *, const set_t *);
-static int compare_options(const void *, const void *);
-static void uncover_set(set_t *);
-static void uncover_clue(clue_t *);
-static void uncover_cell(cell_t *);
-static void clear_set_negative_cache(const int *, const int *, int *);
-static void init_empty_bounds(set_t *, int, int);
-static void init_color_bounds(set_t *, int, int, int);
-static unsigned inc_with_limit(unsigned);
-static int sum_with_limit(int, int);
-static void *alloc_mem(const char *, size_t, int);
-static void *realloc_mem(const char *, void *, size_t, int);
-static void free_data(int, int);
-static void free_cell(cell_t *);
-static void free_clue(clue_t *, int);
-static void free_set(set_t *);
-static void free_ints(int **);
-
-static int width, height, colors_n, *colors, clues_n, grid_size, depth, completed_depth, negative_cache, offset;
-static unsigned time_zero, all_nodes_n, run_nodes_n, failures_n, locked_cells_n, locked_clues_n, locked_sets_n;
-static unsigned long verbose, solutions_max, solutions_n;
-static set_t **sorted_sets, **locked_sets;
-static clue_t *clues, *clues_header, **sorted_clues, **locked_clues, *current_clue;
-static cell_t *cells, **locked_cells;
-
 int main(int argc, char *argv[]) {
 	char *end;
-	int sets_n, i;
-	if (argc < 2 || argc > 3) {
-		fprintf(stderr, "Usage: %s <verbose flag> [<maximum number of solutions>]\n", argv[0]);
-		fflush(stderr);
+	const char *list = NULL;
+	int option, r;
+	unsigned long jobs_n = 1UL, portfolio_n = 1UL, verbose, memory_max, table_size, probes_max, probes_budget, nogoods_max;
+	uintmax_t nodes_max, seed, restart_nodes;
+	nonogram_t *puzzle;
+	nonogram_stats_t stats;
+	nonogram_init_options(&options);
+	while ((option = getopt_long(argc, argv, "b::c:e:f:G:H:i:j:k:m:n:pP:r:R:s:S:t:ux:", long_options, NULL)) != -1) {
+		switch (option) {
+		case 'b':
+			batch = 1;
+			list = optarg;
+			break;
+		case 'j':
+			jobs_n = strtoul(optarg, &end, 10);
+			if (*end || jobs_n < 1UL || jobs_n > WORKERS_MAX) {
+				fputs("Invalid number of workers\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'p':
+			options.profile = stderr;
+			break;
+		case 'u':
+			options.unique = 1;
+			break;
+		case 'P':
+			portfolio_n = strtoul(optarg, &end, 10);
+			if (*end || portfolio_n < 1UL || portfolio_n > WORKERS_MAX) {
+				fputs("Invalid number of portfolio members\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'c':
+			options.checkpoint = optarg;
+			break;
+		case 'H':
+			table_size = strtoul(optarg, &end, 10);
+			if (*end || table_size < 1UL || table_size > SIZE_MAX/MEGABYTE) {
+				fputs("Invalid table size\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.table_size = (size_t)table_size*MEGABYTE;
+			break;
+		case 'i':
+			options.checkpoint_period = strtod(optarg, &end);
+			if (*end || !(options.checkpoint_period > 0.0)) {
+				fputs("Invalid checkpoint interval\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			options.resume = optarg;
+			break;
+		case 's':
+			for (option = 0; option < STRATEGIES_N && strcmp(optarg, strategy_names[option]); ++option);
+			if (option == STRATEGIES_N) {
+				fputs("Invalid branching strategy\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.strategy = option;
+			break;
+		case 'k':
+			probes_max = strtoul(optarg, &end, 10);
+			if (*end || probes_max < 1UL || probes_max > INT_MAX) {
+				fputs("Invalid number of probed sets\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.probes_max = (int)probes_max;
+			break;
+		case 'x':
+			pack_puzzle = strtoul(optarg, &end, 10);
+			if (*end || pack_puzzle < 1UL) {
+				fputs("Invalid puzzle number\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'e':
+			probes_budget = strtoul(optarg, &end, 10);
+			if (*end || probes_budget < 1UL || probes_budget > INT_MAX) {
+				fputs("Invalid probe budget\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.probes_budget = (int)probes_budget;
+			break;
+		case 'n':
+			nodes_max = strtoumax(optarg, &end, 10);
+			if (*end || nodes_max < 1 || nodes_max >= UINT64_MAX) {
+				fputs("Invalid maximum number of nodes\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.nodes_max = (uint64_t)nodes_max;
+			break;
+		case 'S':
+			/* strtoumax accepts a sign and wraps the negative values. */
+			errno = 0;
+			seed = strtoumax(optarg, &end, 10);
+			if (!isdigit((unsigned char)*optarg) || *end || errno == ERANGE) {
+				fputs("Invalid seed\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.seed = (uint64_t)seed;
+			break;
+		case 'R':
+			restart_nodes = strtoumax(optarg, &end, 10);
+			if (*end || restart_nodes < 1 || restart_nodes > UINT32_MAX) {
+				fputs("Invalid number of nodes between restarts\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.restart_nodes = (uint64_t)restart_nodes;
+			break;
+		case 'G':
+			nogoods_max = strtoul(optarg, &end, 10);
+			if (*end || nogoods_max < 1UL || nogoods_max > NOGOODS_MAX) {
+				fputs("Invalid number of nogoods\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.nogoods_max = (int)nogoods_max;
+			break;
+		case 't':
+			options.time_max = strtod(optarg, &end);
+			if (*end || !(options.time_max > 0.0)) {
+				fputs("Invalid maximum time\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'm':
+			memory_max = strtoul(optarg, &end, 10);
+			if (*end || memory_max < 1UL || memory_max > SIZE_MAX/MEGABYTE) {
+				fputs("Invalid maximum memory\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			options.memory_max = (size_t)memory_max*MEGABYTE;
+			break;
+		case 'f':
+			if (!strcmp(optarg, "text")) {
+				format = FORMAT_TEXT;
+			}
+			else if (!strcmp(optarg, "json")) {
+				format = FORMAT_JSON;
+			}
+			else if (!strcmp(optarg, "csv")) {
+				format = FORMAT_CSV;
+			}
+			else {
+				fputs("Invalid output format\n", stderr);
+				fflush(stderr);
+				return EXIT_FAILURE;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (argc-optind < 1 || argc-optind > 2) {
+		usage(argv[0]);
 		return EXIT_FAILURE;
 	}
-	verbose = strtoul(argv[1], &end, 10);
+	options.workers_n = (int)jobs_n;
+	options.portfolio_n = (int)portfolio_n;
+	verbose = strtoul(argv[optind], &end, 10);
 	if (*end) {
 		fputs("Invalid verbose flag\n", stderr);
 		fflush(stderr);
 		return EXIT_FAILURE;
 	}
-	if (argc == 2) {
-		solutions_max = ULONG_MAX;
+
+	/* The trace would break the records of the structured formats. */
+	if (verbose) {
+		options.trace = format == FORMAT_TEXT ? stdout:stderr;
 	}
-	else {
-		solutions_max = strtoul(argv[2], &end, 10);
-		if (*end || solutions_max < 1UL) {
+	if (argc-optind == 2) {
+		options.solutions_max = strtoul(argv[optind+1], &end, 10);
+		if (*end || options.solutions_max < 1UL) {
 			fputs("Invalid maximum number of solutions\n", stderr);
 			fflush(stderr);
 			return EXIT_FAILURE;
 		}
 	}
-	if (scanf("%d%d", &width, &height) != 2 || width < 1 || height < 1) {
-		fputs("Invalid grid attributes\n", stderr);
-		fflush(stderr);
-		return EXIT_FAILURE;
-	}
-	getchar();
-	colors_n = COLOR_POS_BLACK;
-	colors = alloc_mem("colors", sizeof(int), colors_n);
-	if (!colors) {
-		return EXIT_FAILURE;
-	}
-	colors[COLOR_POS_UNKNOWN] = COLOR_UNKNOWN;
-	colors[COLOR_POS_SEVERAL] = COLOR_SEVERAL;
-	colors[COLOR_POS_EMPTY] = COLOR_EMPTY;
-	clues = NULL;
-	cells = NULL;
-	sorted_sets = NULL;
-	locked_sets = NULL;
-	sorted_clues = NULL;
-	locked_clues = NULL;
-	locked_cells = NULL;
-	clues_n = width+height;
-	clues = alloc_mem("clues", sizeof(clue_t), clues_n+1);
-	if (!clues) {
-		free_data(0, 0);
-		return EXIT_FAILURE;
-	}
-	for (i = 0; i < width-1; ++i) {
-		if (!read_clue(clues+i, i, SEPARATOR_CLUES)) {
-			free_data(0, i);
-			return EXIT_FAILURE;
-		}
-	}
-	if (!read_clue(clues+i, i, SEPARATOR_LINES)) {
-		free_data(0, i);
+	puzzle = nonogram_create();
+	if (!puzzle) {
 		return EXIT_FAILURE;
 	}
-	for (++i; i < clues_n-1; ++i) {
-		if (!read_clue(clues+i, i, SEPARATOR_CLUES)) {
-			free_data(0, i);
-			return EXIT_FAILURE;
-		}
-	}
-	if (!read_clue(clues+i, i, SEPARATOR_LINES)) {
-		free_data(0, i);
-		return EXIT_FAILURE;
+	if (format == FORMAT_CSV) {
+		puts("record,puzzle,width,height,colors,time,all_nodes,run_nodes,failures,sweep_failures,depth,max_depth,completed_depth,locked_cells,solutions,answer,aborted,table_hits,table_misses,winner,strategy,seed,restarts,nogoods,nogood_hits,grid");
 	}
-	clues_header = clues+clues_n;
-	clues_header->pos = clues_n;
-	link_clue(clues, clues_header, clues+1);
-	for (i = 1; i < clues_n; ++i) {
-		link_clue(clues+i, clues+i-1, clues+i+1);
+	if (batch) {
+		r = solve_batch(puzzle, list);
+		nonogram_destroy(puzzle);
+		return r ? EXIT_SUCCESS:EXIT_FAILURE;
 	}
-	link_clue(clues_header, clues_header-1, clues);
-	grid_size = width*height;
-	cells = alloc_mem("cells", sizeof(cell_t), grid_size+clues_n);
-	if (!cells) {
-		free_data(0, clues_n);
+	if (!nonogram_load(puzzle, stdin)) {
+		nonogram_destroy(puzzle);
 		return EXIT_FAILURE;
 	}
-	for (i = width; i--; ) {
-		int j;
-		for (j = height; j--; ) {
-			if (!init_cell(cells+j*width+i, clues+i, clues+width+j)) {
-				free_data(j*width+i, clues_n);
-				return EXIT_FAILURE;
-			}
-		}
-	}
-	for (i = width; i--; ) {
-		link_column_clue(clues+i, cells+i);
-	}
-	for (i = height; i--; ) {
-		link_row_clue(clues+width+i, cells+i*width);
-	}
-	sets_n = clues[0].sets_n;
-	for (i = 1; i < clues_n; ++i) {
-		sets_n += clues[i].sets_n;
-	}
-	if (sets_n) {
-		sorted_sets = alloc_mem("sorted_sets", sizeof(set_t *), sets_n);
-		if (!sorted_sets) {
-			free_data(grid_size, clues_n);
-			return EXIT_FAILURE;
-		}
-		locked_sets = alloc_mem("locked_sets", sizeof(set_t *), sets_n);
-		if (!locked_sets) {
-			free_data(grid_size, clues_n);
-			return EXIT_FAILURE;
-		}
-	}
-	sorted_clues = alloc_mem("sorted_clues", sizeof(clue_t *), clues_n);
-	if (!sorted_clues) {
-		free_data(grid_size, clues_n);
-		return EXIT_FAILURE;
-	}
-	locked_clues = alloc_mem("locked_clues", sizeof(clue_t *), clues_n);
-	if (!locked_clues) {
-		free_data(grid_size, clues_n);
-		return EXIT_FAILURE;
-	}
-	locked_cells = alloc_mem("locked_cells", sizeof(cell_t *), grid_size);
-	if (!locked_cells) {
-		free_data(grid_size, clues_n);
-		return EXIT_FAILURE;
-	}
-	time_zero = (unsigned)time(NULL);
-	all_nodes_n = 0U;
-	run_nodes_n = 0U;
-	failures_n = 0U;
-	solutions_n = 0UL;
-	depth = 0;
-	completed_depth = 0;
-	negative_cache = -1;
-	locked_cells_n = 0U;
-	locked_clues_n = 0U;
-	locked_sets_n = 0U;
-	nonogram(NULL, NULL);
-	printf("\nTime %us\nAll nodes %u\nRun nodes %u\nFailures %u\nSolutions %lu\n", (unsigned)time(NULL)-time_zero, all_nodes_n, run_nodes_n, failures_n, solutions_n);
-	fflush(stdout);
-	free_data(grid_size, clues_n);
-	return EXIT_SUCCESS;
-}
-
-static int read_clue(clue_t *clue, int pos, int separator) {
-	int c, len_min;
-	if (getchar() != DELIMITER_CLUE) {
-		fputs("Double quote expected as clue start\n", stderr);
-		fflush(stderr);
-		return 0;
-	}
-	clue->pos = pos;
-	clue->sets_n = 0;
-	clue->sets = alloc_mem("clue->sets", sizeof(set_t), 1);
-	if (!clue->sets) {
-		return 0;
-	}
-	do {
-		int len;
-		if (scanf("%d", &len) != 1 || len < 0) {
-			fputs("Invalid set length\n", stderr);
-			fflush(stderr);
-			free(clue->sets);
-			return 0;
-		}
-		c = getchar();
-		if (len) {
-			int color, color_pos;
-			if (c == SEPARATOR_COLOR) {
-				color = getchar();
-				if (!isalnum(color)) {
-					fputs("Invalid set color\n", stderr);
-					fflush(stderr);
-					free(clue->sets);
-					return 0;
-				}
-				c = getchar();
-			}
-			else {
-				color = COLOR_BLACK;
-			}
-			for (color_pos = COLOR_POS_BLACK; color_pos < colors_n && colors[color_pos] != color; ++color_pos);
-			if (color_pos == colors_n) {
-				int *colors_tmp = realloc_mem("colors", colors, sizeof(int), colors_n+1);
-				if (!colors_tmp) {
-					free(clue->sets);
-					return 0;
-				}
-				colors = colors_tmp;
-				colors[colors_n++] = color;
-			}
-			set_t *sets = realloc_mem("clue->sets", clue->sets, sizeof(set_t), clue->sets_n+2);
-			if (!sets) {
-				free(clue->sets);
-				return 0;
-			}
-			clue->sets = sets;
-			init_set_fields(clue->sets+clue->sets_n, len, color_pos, clue);
-			++clue->sets_n;
-		}
-		if (c != SEPARATOR_SETS && c != DELIMITER_CLUE) {
-			fputs("Invalid set separator\n", stderr);
-			fflush(stderr);
-			free(clue->sets);
-			return 0;
-		}
+	puzzle_name = "stdin";
+	width = nonogram_width(puzzle);
+	height = nonogram_height(puzzle);
+	colors_n = nonogram_colors(puzzle);
+	r = nonogram_solve(puzzle, &options, print_solution, NULL, &stats);
+	if (r && format != FORMAT_TEXT) {
+		print_record("summary", &stats, nonogram_partial_grid(puzzle));
 	}
-	while (c != DELIMITER_CLUE);
-	clue->sets_header = clue->sets+clue->sets_n;
-	init_set_fields(clue->sets_header, 0, COLOR_POS_UNKNOWN, clue);
-	clue->depths_size = DEPTHS_SIZE;
-	clue->sets[0].empty_before = 0;
-	len_min = clue->sets[0].len;
-	if (clue->sets_n) {
-		int relaxation, i;
-		for (i = 1; i < clue->sets_n; ++i) {
-			if (clue->sets[i].color_pos == clue->sets[i-1].color_pos) {
-				clue->sets[i].empty_before = 1;
-				++len_min;
-			}
-			else {
-				clue->sets[i].empty_before = 0;
-			}
-			len_min += clue->sets[i].len;
+	else if (r) {
+		printf("\nTime %.6fs\nAll nodes %" PRIu64 "\nRun nodes %" PRIu64 "\nFailures %" PRIu64 "\nSolutions %lu\n", stats.time, stats.all_nodes_n, stats.run_nodes_n, stats.failures_n, stats.solutions_n);
+		if (options.table_size) {
+			printf("Table hits %" PRIu64 " Misses %" PRIu64 "\n", stats.table_hits_n, stats.table_misses_n);
 		}
-		clue->sets[i].empty_before = 0;
-		if (clue->pos < width) {
-			if (len_min > height) {
-				fputs("Incompatible clue\n", stderr);
-				fflush(stderr);
-				free(clue->sets);
-				return 0;
-			}
-			relaxation = height-len_min;
+		if (options.portfolio_n > 1) {
+			printf("Winner %d Strategy %s\n", stats.winner, strategy_names[stats.strategy]);
 		}
-		else {
-			if (len_min > width) {
-				fputs("Incompatible clue\n", stderr);
-				fflush(stderr);
-				free(clue->sets);
-				return 0;
-			}
-			relaxation = width-len_min;
+		if (options.seed || options.restart_nodes) {
+			printf("Seed %" PRIu64 " Restarts %d\n", stats.seed, stats.restarts_n);
 		}
-		clue->priority = len_min-relaxation;
-		if (!init_set_tables(clue->sets, 0, relaxation, 0, relaxation)) {
-			free(clue->sets);
-			return 0;
+		if (options.nogoods_max) {
+			printf("Nogoods %" PRIu64 " Hits %" PRIu64 "\n", stats.nogoods_n, stats.nogood_hits_n);
 		}
-		link_set(clue->sets, clue->sets_header, clue->sets+1);
-		len_min = clue->sets[0].len+clue->sets[0].empty_before;
-		for (i = 1; i < clue->sets_n; ++i) {
-			if (!init_set_tables(clue->sets+i, len_min, len_min+relaxation, len_min, len_min+relaxation)) {
-				free_clue(clue, i);
-				return 0;
-			}
-			link_set(clue->sets+i, clue->sets+i-1, clue->sets+i+1);
-			len_min += clue->sets[i].len+clue->sets[i].empty_before;
+		if (options.unique) {
+			printf("Answer %s\n", answer_names[get_answer(&stats)]);
 		}
+		print_partial_grid(puzzle, &stats);
+		fflush(stdout);
 	}
-	else {
-		clue->priority = clue->pos < width ? height:width;
-	}
-	if (clue->pos < width) {
-		if (!init_set_tables(clue->sets_header, len_min, height, height, height-1)) {
-			free_clue(clue, clue->sets_n);
-			return 0;
-		}
-		init_empty_bounds(clue->sets_header, DEPTH_BCK, len_min);
-		init_color_bounds(clue->sets_header, DEPTH_BCK, height, height-1);
-	}
-	else {
-		if (!init_set_tables(clue->sets_header, len_min, width, width, width-1)) {
-			free_clue(clue, clue->sets_n);
-			return 0;
-		}
-		init_empty_bounds(clue->sets_header, DEPTH_BCK, len_min);
-		init_color_bounds(clue->sets_header, DEPTH_BCK, width, width-1);
-	}
-	clue->sets_n ? link_set(clue->sets_header, clue->sets_header-1, clue->sets):link_set(clue->sets_header, clue->sets_header, clue->sets_header);
-	if (getchar() != separator) {
-		fputs("Invalid clue separator\n", stderr);
-		fflush(stderr);
-		free_clue(clue, clue->sets_n+1);
-		return 0;
+	nonogram_destroy(puzzle);
+	if (!r) {
+		return EXIT_FAILURE;
 	}
-	return 1;
+	return options.unique ? answer_codes[get_answer(&stats)]:EXIT_SUCCESS;
 }
 
-static void init_set_fields(set_t *set, int len, int color_pos, clue_t *clue) {
-	set->len = len;
-	set->color_pos = color_pos;
-	set->clue = clue;
-	set->empty_bounds_min = NULL;
-	set->color_bounds_min = NULL;
-	set->color_bounds_max = NULL;
-	set->empty_cache = NULL;
-	set->color_cache = NULL;
-	set->options = NULL;
+static void usage(const char *name) {
+	fprintf(stderr, "Usage: %s [-b[<list of puzzle files>]] [-f text|json|csv] [-H <table size in megabytes>] [-s probe|fewest|top|adaptive] [-k <number of probed sets>] [-e <number of probes per node>] [-j <number of workers>] [-P <number of portfolio members>] [-S <seed>] [-R <number of nodes between restarts>] [-G <number of nogoods>] [-u] [-n <maximum number of nodes>] [-t <maximum time in seconds>] [-m <maximum memory in megabytes>] [-c <checkpoint file>] [-i <checkpoint interval in seconds>] [-r <checkpoint file>] [-x <puzzle number in packs>] [-p] <verbose flag> [<maximum number of solutions>]\n", name);
+	fflush(stderr);
 }
 
-static int init_set_tables(set_t *set, int empty_bound_min, int empty_bound_max, int color_bound_min, int color_bound_max) {
-	int cache_size, i;
-	set->empty_bounds_min = alloc_mem("set->empty_bounds_min", sizeof(int), DEPTHS_SIZE);
-	if (!set->empty_bounds_min) {
-		return 0;
-	}
-	init_empty_bounds(set, DEPTH_CUR, empty_bound_min);
-	set->color_bounds_min = alloc_mem("set->color_bounds_min", sizeof(int), DEPTHS_SIZE);
-	if (!set->color_bounds_min) {
-		free_set(set);
-		return 0;
-	}
-	set->color_bounds_max = alloc_mem("set->color_bounds_max", sizeof(int), DEPTHS_SIZE);
-	if (!set->color_bounds_max) {
-		free_set(set);
-		return 0;
+/* Solves many puzzles with the same context, one record is printed for each
+puzzle instead of the solutions. The total line is only printed in text
+format so that all the records of the structured formats share one layout. */
+static int solve_batch(nonogram_t *puzzle, const char *list) {
+	int r;
+	unsigned long puzzles_n = 0UL;
+	double time;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	r = list ? solve_list(puzzle, list, &puzzles_n):solve_stream(puzzle, &puzzles_n);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (format != FORMAT_TEXT) {
+		return r;
 	}
-	init_color_bounds(set, DEPTH_CUR, color_bound_min, color_bound_max);
-	cache_size = empty_bound_max-empty_bound_min+1;
-	set->empty_cache = alloc_mem("set->empty_cache", sizeof(int), cache_size);
-	if (!set->empty_cache) {
-		free_set(set);
+	time = (double)(end.tv_sec-start.tv_sec)+(double)(end.tv_nsec-start.tv_nsec)/1000000000.0;
+	printf("Batch Puzzles %lu Time %ldms Rate %.0f/s\n", puzzles_n, (long)(end.tv_sec-start.tv_sec)*1000L+(end.tv_nsec-start.tv_nsec)/1000000L, time > 0.0 ? (double)puzzles_n/time:0.0);
+	fflush(stdout);
+	return r;
+}
+
+/* The puzzles follow each other on the standard input, it is read in one
+buffer before they are parsed. Reading stops at the first invalid puzzle as
+the next one cannot be located. */
+static int solve_stream(nonogram_t *puzzle, unsigned long *puzzles_n) {
+	char name[32];
+	size_t size, pos, used;
+	char *text = read_input(stdin, &size);
+	if (!text) {
 		return 0;
 	}
-	for (i = cache_size; i--; ) {
-		set->empty_cache[i] = CACHE_UNKNOWN;
-	}
-	cache_size = color_bound_max-color_bound_min+1;
-	if (cache_size) {
-		set->color_cache = alloc_mem("set->color_cache", sizeof(int), cache_size);
-		if (!set->color_cache) {
-			free_set(set);
-			return 0;
-		}
-		for (i = cache_size; i--; ) {
-			set->color_cache[i] = CACHE_UNKNOWN;
-		}
-		set->options = alloc_mem("set->options", sizeof(option_t), cache_size);
-		if (!set->options) {
-			free_set(set);
+	for (pos = skip_blanks(text, size, 0); pos < size; pos = skip_blanks(text, size, pos+used)) {
+		sprintf(name, "stdin:%lu", *puzzles_n+1UL);
+		if (!solve_puzzle(puzzle, name, nonogram_parse(puzzle, text+pos, size-pos, &used))) {
+			free(text);
 			return 0;
 		}
+		++*puzzles_n;
 	}
+	free(text);
 	return 1;
 }
 
-static void link_set(set_t *set, set_t *last, set_t *next) {
-	set->last = last;
-	set->next = next;
-}
-
-static void link_clue(clue_t *clue, clue_t *last, clue_t *next) {
-	clue->last = last;
-	clue->next = next;
-}
-
-static int init_cell(cell_t *cell, clue_t *column_clue, clue_t *row_clue) {
-	int i;
-	cell->column_clue = column_clue;
-	cell->row_clue = row_clue;
-	cell->color_pos = COLOR_POS_UNKNOWN;
-	cell->color_cache = alloc_mem("cell->color_cache", sizeof(int), colors_n-COLOR_POS_EMPTY);
-	if (!cell->color_cache) {
+/* The list contains one puzzle file name per line, an invalid puzzle does not
+stop the batch. */
+static int solve_list(nonogram_t *puzzle, const char *list, unsigned long *puzzles_n) {
+	char filename[FILENAME_SIZE];
+	int errors_n = 0;
+	FILE *list_file = fopen(list, "r");
+	if (!list_file) {
+		fprintf(stderr, "Could not open %s\n", list);
+		fflush(stderr);
 		return 0;
 	}
-	for (i = COLOR_POS_EMPTY; i < colors_n; ++i) {
-		cell->color_cache[i-COLOR_POS_EMPTY] = CACHE_UNKNOWN;
-	}
-	return 1;
-}
-
-static void link_column_clue(clue_t *clue, cell_t *cell_first) {
-	clue->cells_header = cells+grid_size+clue->pos;
-	if (height > 1) {
-		int i;
-		link_column_cell(cell_first, clue->cells_header, cell_first+width);
-		for (i = width; i < grid_size-width; i += width) {
-			link_column_cell(cell_first+i, cell_first+i-width, cell_first+i+width);
+	while (fgets(filename, FILENAME_SIZE, list_file)) {
+		filename[strcspn(filename, "\r\n")] = '\0';
+		if (!filename[0]) {
+			continue;
 		}
-		link_column_cell(cell_first+i, cell_first+i-width, clue->cells_header);
-		link_column_cell(clue->cells_header, cell_first+i, cell_first);
-	}
-	else {
-		link_column_cell(cell_first, clue->cells_header, clue->cells_header);
-		link_column_cell(clue->cells_header, cell_first, cell_first);
-	}
-}
-
-static void link_column_cell(cell_t *cell, cell_t *last, cell_t *next) {
-	cell->column_last = last;
-	cell->column_next = next;
-}
-
-static void link_row_clue(clue_t *clue, cell_t *cell_first) {
-	clue->cells_header = cells+grid_size+clue->pos;
-	if (width > 1) {
-		int i;
-		link_row_cell(cell_first, clue->cells_header, cell_first+1);
-		for (i = 1; i < width-1; ++i) {
-			link_row_cell(cell_first+i, cell_first+i-1, cell_first+i+1);
+		if (!solve_file(puzzle, filename, puzzles_n)) {
+			++errors_n;
 		}
-		link_row_cell(cell_first+i, cell_first+i-1, clue->cells_header);
-		link_row_cell(clue->cells_header, cell_first+i, cell_first);
-	}
-	else {
-		link_row_cell(cell_first, clue->cells_header, clue->cells_header);
-		link_row_cell(clue->cells_header, cell_first, cell_first);
 	}
+	fclose(list_file);
+	return !errors_n;
 }
 
-static void link_row_cell(cell_t *cell, cell_t *last, cell_t *next) {
-	cell->row_last = last;
-	cell->row_next = next;
-}
-
-static void nonogram(clue_t *clue_first, option_t *evaluated) {
-	int changes_sum, sorted_clues_n, changes_n, clue_options_min;
-	unsigned locked_cells_n_bak, locked_clues_n_bak;
-	clue_t *clue;
-	all_nodes_n = inc_with_limit(all_nodes_n);
-	if (!evaluated) {
-		run_nodes_n = inc_with_limit(run_nodes_n);
-	}
-	if (solutions_n == solutions_max) {
-		if (evaluated) {
-			init_option(evaluated, -1, 0);
-		}
-		return;
-	}
-	locked_cells_n_bak = locked_cells_n;
-	locked_clues_n_bak = locked_clues_n;
-	changes_sum = 0;
-	for (clue = clues_header->next; clue != clues_header; clue = clue->next) {
-		int i;
-		if (clue->depths_size < depth+DEPTHS_SIZE) {
-			for (i = clue->sets_n+1; i--; ) {
-				if (!reallocate_bounds(clue->sets+i, depth+DEPTHS_SIZE)) {
-					if (evaluated) {
-						init_option(evaluated, -1, 0);
-					}
-					return;
-				}
-			}
-			clue->depths_size = depth+DEPTHS_SIZE;
-		}
-		for (i = clue->sets_n+1; i--; ) {
-			init_empty_bounds(clue->sets+i, depth+DEPTH_BCK, clue->sets[i].empty_bounds_min[DEPTH_CUR]);
-			init_color_bounds(clue->sets+i, depth+DEPTH_BCK, clue->sets[i].color_bounds_min[DEPTH_CUR], clue->sets[i].color_bounds_max[DEPTH_CUR]);
+/* The puzzle file is mapped in memory and parsed in place, or decoded when it
+is a pack of binary puzzles. */
+static int solve_file(nonogram_t *puzzle, const char *filename, unsigned long *puzzles_n) {
+	int fd = open(filename, O_RDONLY), r;
+	size_t used;
+	void *text;
+	struct stat file_stat;
+	if (fd == -1 || fstat(fd, &file_stat) == -1) {
+		fprintf(stderr, "Could not open %s\n", filename);
+		fflush(stderr);
+		if (fd != -1) {
+			close(fd);
 		}
+		print_failure(filename, "error");
+		return 0;
 	}
-	if (clue_first) {
-		sorted_clues[0] = clue_first;
-		sorted_clues_n = 1;
+	if (!file_stat.st_size) {
+		close(fd);
+		return solve_puzzle(puzzle, filename, nonogram_parse(puzzle, "", 0, &used));
 	}
-	else {
-		sorted_clues_n = 0;
-		for (clue = clues_header->next; clue != clues_header; clue = clue->next) {
-			sorted_clues[sorted_clues_n++] = clue;
-		}
-		qsort(sorted_clues, (size_t)sorted_clues_n, sizeof(clue_t *), compare_priorities);
-	}
-	do {
-		int i;
-		changes_n = 0;
-		clue_options_min = INT_MAX;
-		for (clue = clues_header->next; clue != clues_header; clue = clue->next) {
-			clue->priority = 0;
-		}
-		for (i = 0; i < sorted_clues_n; i++) {
-			int clue_options_n, j;
-			cell_t *cell;
-			current_clue = sorted_clues[i];
-			if (current_clue->pos < width) {
-				offset = width;
-				clue_options_n = sweep_clue(current_clue->sets, 0, cells+current_clue->pos);
-			}
-			else {
-				offset = 1;
-				clue_options_n = sweep_clue(current_clue->sets, 0, cells+(current_clue->pos-width)*width);
-			}
-			if (clue_options_n < clue_options_min) {
-				clue_options_min = clue_options_n;
-				if (clue_options_min == negative_cache) {
-					break;
-				}
-			}
-			if (current_clue->pos < width) {
-				for (cell = current_clue->cells_header->column_next; cell != current_clue->cells_header; cell = cell->column_next) {
-					changes_n += check_cell_colors(cell);
-				}
-			}
-			else {
-				for (cell = current_clue->cells_header->row_next; cell != current_clue->cells_header; cell = cell->row_next) {
-					changes_n += check_cell_colors(cell);
-				}
-			}
-			for (j = 0; j < current_clue->sets_n; ++j) {
-				update_empty_bound_and_cache(current_clue->sets[j].empty_bounds_min, current_clue->sets[j].color_bounds_max, current_clue->sets[j].empty_cache);
-				update_color_bounds_and_cache(current_clue->sets[j].color_bounds_min, current_clue->sets[j].color_bounds_max, current_clue->sets[j].color_cache);
-			}
-			update_empty_bound_and_cache(current_clue->sets[j].empty_bounds_min, current_clue->sets[j].color_bounds_min, current_clue->sets[j].empty_cache);
-			if (clue_options_n == 1) {
-				current_clue->last->next = current_clue->next;
-				current_clue->next->last = current_clue->last;
-				locked_clues[locked_clues_n++] = current_clue;
-			}
-		}
-		if (changes_n && clue_options_min > 0) {
-			if (clues_header->next != clues_header) {
-				sorted_clues_n = 0;
-				for (clue = clues_header->next; clue != clues_header; clue = clue->next) {
-					if (clue->priority) {
-						sorted_clues[sorted_clues_n++] = clue;
-					}
-				}
-				qsort(sorted_clues, (size_t)sorted_clues_n, sizeof(clue_t *), compare_priorities);
-			}
-			changes_sum += changes_n;
-		}
+	text = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (text == MAP_FAILED) {
+		fprintf(stderr, "Could not map %s\n", filename);
+		fflush(stderr);
+		print_failure(filename, "error");
+		return 0;
 	}
-	while (changes_n && clue_options_min > 0 && clues_header->next != clues_header);
-	if (clue_options_min > 0) {
-		if (evaluated) {
-			clues_header->next != clues_header ? init_option(evaluated, 0, changes_sum):init_option(evaluated, 1, changes_sum);
-		}
-		else {
-			if (verbose || clues_header->next == clues_header) {
-				printf("\nTime %us\nAll nodes %u\nRun nodes %u\nFailures %u\nDepth %d Completed %d\nCells %d Locked %u\n", (unsigned)time(NULL)-time_zero, all_nodes_n, run_nodes_n, failures_n, depth, completed_depth, grid_size, locked_cells_n);
-				fflush(stdout);
-			}
-			if (clues_header->next != clues_header) {
-				int sorted_sets_n = 0;
-				unsigned locked_sets_n_bak = locked_sets_n;
-				set_t *set_min;
-				for (clue = clues_header->next; clue != clues_header; clue = clue->next) {
-					set_t *set;
-					for (set = clue->sets_header->next; set != clue->sets_header; set = set->next) {
-						if (set->color_bounds_min[DEPTH_CUR] == set->color_bounds_max[DEPTH_CUR]) {
-							set->last->next = set->next;
-							set->next->last = set->last;
-							locked_sets[locked_sets_n++] = set;
-						}
-					}
-					for (set = clue->sets_header->next; set != clue->sets_header; set = set->next) {
-						int i;
-						set->options_n = 0;
-						set->solutions_n = 0;
-						set->changes_sum = 0;
-						set->skipped = 0;
-						for (i = set->color_bounds_min[DEPTH_CUR]; i <= set->color_bounds_max[DEPTH_CUR]; ++i) {
-							if (set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
-								set->options[set->options_n++].pos = i;
-							}
-						}
-						set->others_n = set->options_n;
-						sorted_sets[sorted_sets_n++] = set;
-					}
-				}
-				do {
-					qsort(sorted_sets, (size_t)sorted_sets_n, sizeof(set_t *), compare_sets);
-					changes_n = evaluate_set(sorted_sets[0]);
-					set_min = init_set_min(sorted_sets[0]);
-					if (set_min->others_n > 1) {
-						int i;
-						for (i = 1; i < sorted_sets_n; ++i) {
-							changes_n += evaluate_set(sorted_sets[i]);
-							if (compare_evaluations(sorted_sets[i], set_min) < 0) {
-								set_min = init_set_min(sorted_sets[i]);
-								if (set_min->others_n < 2) {
-									break;
-								}
-							}
-						}
-					}
-					if (verbose) {
-						printf("Removed options %d\n", changes_n);
-						fflush(stdout);
-					}
-				}
-				while (changes_n && set_min->others_n > 1);
-				if (set_min->options_n) {
-					int i;
-					qsort(set_min->options, (size_t)set_min->options_n, sizeof(option_t), compare_options);
-					for (i = set_min->options_n; i--; ) {
-						set_min->color_cache[set_min->options[i].pos-set_min->color_bounds_min[DEPTH_BCK]] = negative_cache;
-					}
-					for (i = set_min->options_n; i--; ) {
-						if (depth == completed_depth && i == set_min->options_n-1) {
-							completed_depth = depth+1;
-						}
-						set_min->color_cache[set_min->options[i].pos-set_min->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
-						++depth;
-						--negative_cache;
-						nonogram(set_min->clue, NULL);
-						++negative_cache;
-						--depth;
-						set_min->color_cache[set_min->options[i].pos-set_min->color_bounds_min[DEPTH_BCK]] = negative_cache;
-					}
-					for (i = set_min->options_n; i--; ) {
-						set_min->color_cache[set_min->options[i].pos-set_min->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
-					}
-				}
-				else {
-					failures_n = inc_with_limit(failures_n);
-				}
-				while (locked_sets_n > locked_sets_n_bak) {
-					uncover_set(locked_sets[--locked_sets_n]);
-				}
-			}
-			else {
-				int i;
-				++solutions_n;
-				for (i = 0; i < grid_size; i += width) {
-					int j;
-					for (j = 0; j < width; ++j) {
-						putchar(colors[cells[i+j].color_pos]);
-					}
-					puts("");
-				}
-				fflush(stdout);
-			}
-		}
+	if ((size_t)file_stat.st_size >= NONOGRAM_PACK_HEADER_SIZE && !memcmp(text, NONOGRAM_PACK_MAGIC, strlen(NONOGRAM_PACK_MAGIC))) {
+		r = solve_pack(puzzle, filename, text, (size_t)file_stat.st_size, puzzles_n);
 	}
 	else {
-		if (evaluated) {
-			init_option(evaluated, -1, 0);
-		}
-	}
-	while (locked_clues_n > locked_clues_n_bak) {
-		uncover_clue(locked_clues[--locked_clues_n]);
-	}
-	while (locked_cells_n > locked_cells_n_bak) {
-		uncover_cell(locked_cells[--locked_cells_n]);
-	}
-	for (clue = clues_header->next; clue->pos < width; clue = clue->next) {
-		cell_t *cell;
-		for (cell = clue->cells_header->column_next; cell != clue->cells_header; cell = cell->column_next) {
-			int i;
-			for (i = COLOR_POS_EMPTY; i < colors_n; ++i) {
-				if (cell->color_cache[i-COLOR_POS_EMPTY] == negative_cache) {
-					cell->color_cache[i-COLOR_POS_EMPTY] = CACHE_UNKNOWN;
-				}
-			}
+		r = solve_puzzle(puzzle, filename, nonogram_parse(puzzle, text, (size_t)file_stat.st_size, &used));
+		if (r) {
+			++*puzzles_n;
 		}
 	}
-	for (clue = clues_header->next; clue != clues_header; clue = clue->next) {
-		int i;
-		for (i = 0; i < clue->sets_n; ++i) {
-			clear_set_negative_cache(clue->sets[i].color_bounds_min, clue->sets[i].color_bounds_max, clue->sets[i].color_cache);
-			clear_set_negative_cache(clue->sets[i].empty_bounds_min, clue->sets[i].color_bounds_max, clue->sets[i].empty_cache);
-			init_color_bounds(clue->sets+i, DEPTH_CUR, clue->sets[i].color_bounds_min[depth+DEPTH_BCK], clue->sets[i].color_bounds_max[depth+DEPTH_BCK]);
-			init_empty_bounds(clue->sets+i, DEPTH_CUR, clue->sets[i].empty_bounds_min[depth+DEPTH_BCK]);
-		}
-		clear_set_negative_cache(clue->sets[i].empty_bounds_min, clue->sets[i].color_bounds_min, clue->sets[i].empty_cache);
-		init_empty_bounds(clue->sets+i, DEPTH_CUR, clue->sets[i].empty_bounds_min[depth+DEPTH_BCK]);
-	}
-}
-
-static void init_option(option_t *option, int r, int changes_sum) {
-	option->r = r;
-	option->changes_sum = changes_sum;
+	munmap(text, (size_t)file_stat.st_size);
+	return r;
 }
 
-static int reallocate_bounds(set_t *set, int depths_size) {
-	int *empty_bounds_min = realloc_mem("set->empty_bounds_min", set->empty_bounds_min, sizeof(int), depths_size), *color_bounds_min, *color_bounds_max;
-	if (!empty_bounds_min) {
-		return 0;
-	}
-	set->empty_bounds_min = empty_bounds_min;
-	color_bounds_min = realloc_mem("set->color_bounds_min", set->color_bounds_min, sizeof(int), depths_size);
-	if (!color_bounds_min) {
+/* Solves all the puzzles of the pack, or only the one selected by -x that is
+located directly from the index. */
+static int solve_pack(nonogram_t *puzzle, const char *filename, const unsigned char *data, size_t size, unsigned long *puzzles_n) {
+	int errors_n = 0;
+	uint64_t records_n = read_uint(data+4, 4), index = read_uint(data+8, 8), i, last;
+	if (index > size || (size-index)/8 <= records_n || (pack_puzzle && pack_puzzle > records_n)) {
+		fprintf(stderr, "Invalid pack %s\n", filename);
+		fflush(stderr);
+		print_failure(filename, "invalid");
 		return 0;
 	}
-	set->color_bounds_min = color_bounds_min;
-	color_bounds_max = realloc_mem("set->color_bounds_max", set->color_bounds_max, sizeof(int), depths_size);
-	if (!color_bounds_max) {
-		return 0;
+	i = pack_puzzle ? pack_puzzle-1:0;
+	last = pack_puzzle ? pack_puzzle:records_n;
+	for (; i < last; ++i) {
+		uint64_t start = read_uint(data+index+i*8, 8), end = read_uint(data+index+i*8+8, 8);
+		const unsigned char *name_end;
+		if (start > end || end > index || !(name_end = memchr(data+start, '\0', (size_t)(end-start)))) {
+			char name[FILENAME_SIZE+32];
+			fprintf(stderr, "Invalid record %" PRIu64 " in pack %s\n", i+1, filename);
+			fflush(stderr);
+			sprintf(name, "%s:%" PRIu64, filename, i+1);
+			print_failure(name, "invalid");
+			++errors_n;
+			continue;
+		}
+		++name_end;
+		if (solve_puzzle(puzzle, (const char *)(data+start), nonogram_decode(puzzle, name_end, (size_t)(data+end-name_end)))) {
+			++*puzzles_n;
+		}
+		else {
+			++errors_n;
+		}
 	}
-	set->color_bounds_max = color_bounds_max;
-	return 1;
+	return !errors_n;
 }
 
-static int compare_priorities(const void *a, const void *b) {
-	clue_t *clue_a = *(clue_t * const *)a, *clue_b = *(clue_t * const *)b;
-	if (clue_a->priority != clue_b->priority) {
-		return clue_b->priority-clue_a->priority;
+static uint64_t read_uint(const unsigned char *data, int bytes_n) {
+	uint64_t value = 0;
+	while (bytes_n--) {
+		value = value << 8 | data[bytes_n];
 	}
-	return clue_a->pos-clue_b->pos;
+	return value;
 }
 
-static int sweep_clue(set_t *set, int pos, cell_t *start_cell) {
-	int i;
-	cell_t *cell;
-	for (i = pos, cell = start_cell; i < set->color_bounds_min[DEPTH_CUR] && cell->color_cache[0] >= CACHE_UNKNOWN; ++i, cell += offset);
-	if (i >= set->color_bounds_min[DEPTH_CUR]) {
-		int r_sum = 0;
-		cell_t *last_ok_cell = start_cell;
-		if (set != current_clue->sets_header) {
-			int j, len = 0, last_ok = i, sum;
-			cell_t *colored_cell;
-			for (j = i; j <= set->color_bounds_max[DEPTH_CUR]; ++j, cell += offset) {
-				if (set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] != CACHE_UNKNOWN) {
-					len = 0;
-					if (set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] > CACHE_UNKNOWN) {
-						r_sum = sum_with_limit(r_sum, set->color_cache[j-set->color_bounds_min[DEPTH_BCK]]);
-						last_ok_cell = cell;
-						last_ok = j;
-					}
-					if (cell->color_cache[0] < CACHE_UNKNOWN) {
-						++j;
-						break;
-					}
-				}
-				else {
-					int r;
-					if (set->empty_before) {
-						if (cell->color_cache[0] >= CACHE_UNKNOWN) {
-							r = sweep_set(set, j+1, cell+offset, &colored_cell, &len);
-							if (r > 0) {
-								cell->color_cache[0] = CACHE_CONFIRMED;
-							}
-						}
-						else {
-							len = 0;
-							r = negative_cache;
-						}
-					}
-					else {
-						r = sweep_set(set, j, cell, &colored_cell, &len);
-					}
-					if (r > 0) {
-						set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] = r;
-						r_sum = sum_with_limit(r_sum, r);
-						last_ok_cell = cell;
-						last_ok = j;
-					}
-					else {
-						set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] = negative_cache;
-						if (len > 0) {
-							int k;
-							if (j+len < set->color_bounds_max[DEPTH_CUR]) {
-								k = j+len;
-							}
-							else {
-								if (cell->color_cache[0] < CACHE_UNKNOWN || !r) {
-									for (k = set->color_bounds_max[DEPTH_CUR]; k > j; --k) {
-										if (set->empty_cache[k-set->empty_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
-											set->empty_cache[k-set->empty_bounds_min[DEPTH_BCK]] = negative_cache;
-										}
-									}
-								}
-								k = set->color_bounds_max[DEPTH_CUR];
-							}
-							for (; k > j; --k) {
-								if (set->color_cache[k-set->color_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
-									set->color_cache[k-set->color_bounds_min[DEPTH_BCK]] = negative_cache;
-								}
-							}
-						}
-					}
-					if (cell->color_cache[0] < CACHE_UNKNOWN || !r) {
-						++j;
-						break;
-					}
-					if (len > 0) {
-						if (j+len < set->color_bounds_max[DEPTH_CUR]) {
-							j += len;
-							cell += len*offset;
-						}
-						else {
-							j = set->color_bounds_max[DEPTH_CUR];
-						}
-					}
-				}
-			}
-			for (--j; j > last_ok; --j) {
-				if (set->empty_cache[j-set->empty_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
-					set->empty_cache[j-set->empty_bounds_min[DEPTH_BCK]] = negative_cache;
-				}
-			}
-			sum = 0;
-			for (; j > i; --j) {
-				if (set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] > CACHE_UNKNOWN) {
-					sum = sum_with_limit(sum, set->color_cache[j-set->color_bounds_min[DEPTH_BCK]]);
-				}
-				set->empty_cache[j-set->empty_bounds_min[DEPTH_BCK]] = sum;
-			}
-		}
-		else {
-			++r_sum;
-			last_ok_cell = cell;
-		}
-		for (cell = last_ok_cell-offset; cell >= start_cell; cell -= offset) {
-			cell->color_cache[0] = CACHE_CONFIRMED;
-		}
-		if (r_sum) {
-			for (; i >= pos; --i) {
-				set->empty_cache[i-set->empty_bounds_min[DEPTH_BCK]] = r_sum;
+/* Reads the whole input by blocks, the buffer size is doubled when it is
+full. */
+static char *read_input(FILE *input, size_t *size) {
+	size_t text_size = INPUT_BLOCK, read_n;
+	char *text = malloc(text_size);
+	if (!text) {
+		fputs("Could not allocate memory for input\n", stderr);
+		fflush(stderr);
+		return NULL;
+	}
+	*size = 0;
+	while ((read_n = fread(text+*size, 1, text_size-*size, input)) > 0) {
+		*size += read_n;
+		if (*size == text_size) {
+			char *text_tmp = realloc(text, text_size*2);
+			if (!text_tmp) {
+				fputs("Could not reallocate memory for input\n", stderr);
+				fflush(stderr);
+				free(text);
+				return NULL;
 			}
-			return r_sum;
+			text = text_tmp;
+			text_size *= 2;
 		}
 	}
-	for (; i >= pos; --i) {
-		set->empty_cache[i-set->empty_bounds_min[DEPTH_BCK]] = negative_cache;
-	}
-	return negative_cache;
+	return text;
 }
 
-static int sweep_set(set_t *set, int pos, cell_t *start_cell, cell_t **colored_cell, int *len) {
-	int next_pos = pos+set->len, i;
-	cell_t *cell;
-	if (*len == -1) {
-		i = next_pos-1;
-		start_cell += (set->len-1)*offset;
-	}
-	else {
-		*colored_cell = NULL;
-		i = pos;
-	}
-	for (cell = start_cell; i < next_pos; ++i, cell += offset) {
-		if (cell->color_cache[0] < CACHE_UNKNOWN && !*colored_cell) {
-			*colored_cell = cell;
-		}
-		if (cell->color_cache[set->color_pos-COLOR_POS_EMPTY] < CACHE_UNKNOWN) {
-			break;
-		}
-	}
-	if (i == next_pos) {
-		int r;
-		set_t *next_set = set+1;
-		r = next_set->empty_cache[next_pos-next_set->empty_bounds_min[DEPTH_BCK]] != CACHE_UNKNOWN ? next_set->empty_cache[next_pos-next_set->empty_bounds_min[DEPTH_BCK]]:sweep_clue(next_set, next_pos, cell);
-		if (r > 0) {
-			for (cell -= offset; cell >= start_cell; cell -= offset) {
-				cell->color_cache[set->color_pos-COLOR_POS_EMPTY] = CACHE_CONFIRMED;
-			}
-			*len = -1;
-		}
-		else {
-			*len = 0;
-		}
-		return r;
-	}
-	*len = i-pos;
-	if (*colored_cell) {
+/* The puzzle was just loaded, or could not be when loaded is 0. */
+static int solve_puzzle(nonogram_t *puzzle, const char *name, int loaded) {
+	nonogram_stats_t stats;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (!loaded) {
+		print_failure(name, "invalid");
 		return 0;
 	}
-	return negative_cache;
-}
-
-static int check_cell_colors(cell_t *cell) {
-	int changes_n = 0, color_pos = COLOR_POS_UNKNOWN, i;
-	for (i = COLOR_POS_EMPTY; i < colors_n; ++i) {
-		if (cell->color_cache[i-COLOR_POS_EMPTY] == CACHE_UNKNOWN) {
-			cell->color_cache[i-COLOR_POS_EMPTY] = negative_cache;
-			++cell->column_clue->priority;
-			++cell->row_clue->priority;
-			++changes_n;
-		}
-		else if (cell->color_cache[i-COLOR_POS_EMPTY] == CACHE_CONFIRMED) {
-			cell->color_cache[i-COLOR_POS_EMPTY] = CACHE_UNKNOWN;
-			if (color_pos == COLOR_POS_UNKNOWN) {
-				color_pos = i;
-			}
-			else if (color_pos != COLOR_POS_SEVERAL) {
-				color_pos = COLOR_POS_SEVERAL;
-			}
+	puzzle_name = name;
+	memset(&stats, 0, sizeof(nonogram_stats_t));
+	width = nonogram_width(puzzle);
+	height = nonogram_height(puzzle);
+	colors_n = nonogram_colors(puzzle);
+	if (!nonogram_solve(puzzle, &options, print_solution, NULL, &stats)) {
+		if (format != FORMAT_TEXT) {
+			print_record("error", &stats, NULL);
+			return 0;
 		}
+		printf("Puzzle %s Error\n", name);
+		fflush(stdout);
+		return 0;
 	}
-	if (color_pos > COLOR_POS_SEVERAL) {
-		cell->color_pos = color_pos;
-		cell->color_cache[color_pos-COLOR_POS_EMPTY] = CACHE_CONFIRMED;
-		cell->column_last->column_next = cell->column_next;
-		cell->column_next->column_last = cell->column_last;
-		cell->row_last->row_next = cell->row_next;
-		cell->row_next->row_last = cell->row_last;
-		locked_cells[locked_cells_n++] = cell;
+	if (format != FORMAT_TEXT) {
+		print_record("summary", &stats, nonogram_partial_grid(puzzle));
+		return 1;
 	}
-	return changes_n;
-}
-
-static void update_empty_bound_and_cache(int *bounds_min, const int *bounds_max, int *cache) {
-	for (; bounds_min[DEPTH_CUR] <= bounds_max[DEPTH_CUR] && cache[bounds_min[DEPTH_CUR]-bounds_min[DEPTH_BCK]] <= CACHE_UNKNOWN; ++bounds_min[DEPTH_CUR]);
-	clear_set_positive_cache(bounds_min, bounds_max, cache);
-}
-
-static void update_color_bounds_and_cache(int *bounds_min, int *bounds_max, int *cache) {
-	for (; bounds_min[DEPTH_CUR] <= bounds_max[DEPTH_CUR] && cache[bounds_min[DEPTH_CUR]-bounds_min[DEPTH_BCK]] <= CACHE_UNKNOWN; ++bounds_min[DEPTH_CUR]);
-	for (; bounds_max[DEPTH_CUR] >= bounds_min[DEPTH_CUR] && cache[bounds_max[DEPTH_CUR]-bounds_min[DEPTH_BCK]] <= CACHE_UNKNOWN; --bounds_max[DEPTH_CUR]);
-	clear_set_positive_cache(bounds_min, bounds_max, cache);
-}
-
-static void clear_set_positive_cache(const int *bounds_min, const int *bounds_max, int *cache) {
-	int i;
-	for (i = bounds_min[DEPTH_CUR]; i <= bounds_max[DEPTH_CUR]; ++i) {
-		if (cache[i-bounds_min[DEPTH_BCK]] > CACHE_UNKNOWN) {
-			cache[i-bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
-		}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("Puzzle %s Size %dx%d Solutions %lu Time %ldus All nodes %" PRIu64 " Run nodes %" PRIu64 " Failures %" PRIu64 "", name, width, height, stats.solutions_n, (long)(end.tv_sec-start.tv_sec)*1000000L+(end.tv_nsec-start.tv_nsec)/1000L, stats.all_nodes_n, stats.run_nodes_n, stats.failures_n);
+	if (options.table_size) {
+		printf(" Table hits %" PRIu64 " Misses %" PRIu64, stats.table_hits_n, stats.table_misses_n);
 	}
-}
-
-static int compare_sets(const void *a, const void *b) {
-	int r;
-	set_t *set_a = *(set_t * const *)a, *set_b = *(set_t * const *)b;
-	r = compare_evaluations(set_a, set_b);
-	if (r) {
-		return r;
+	if (options.portfolio_n > 1) {
+		printf(" Winner %d Strategy %s", stats.winner, strategy_names[stats.strategy]);
 	}
-	if (set_a < set_b) {
-		return -1;
+	if (options.seed || options.restart_nodes) {
+		printf(" Seed %" PRIu64 " Restarts %d", stats.seed, stats.restarts_n);
 	}
-	return 1;
-}
-
-static int evaluate_set(set_t *set) {
-	int options_n = set->options_n, i;
-	for (i = options_n; i--; ) {
-		set->color_cache[set->options[i].pos-set->color_bounds_min[DEPTH_BCK]] = negative_cache;
+	if (options.nogoods_max) {
+		printf(" Nogoods %" PRIu64 " Hits %" PRIu64, stats.nogoods_n, stats.nogood_hits_n);
 	}
-	set->options_n = 0;
-	set->solutions_n = 0;
-	set->changes_sum = 0;
-	set->skipped = 0;
-	i = 0;
-	do {
-		int j, lo, hi;
-		for (j = i+1; j < options_n; ++j) {
-			if (set->options[j-1].pos+1 < set->options[j].pos) {
-				break;
-			}
-		}
-		for (lo = i; lo < j; ++lo) {
-			evaluate_option(set, set->options+lo);
-			if (set->options[lo].r >= 0) {
-				break;
-			}
-		}
-		for (hi = j-1; hi > lo; --hi) {
-			evaluate_option(set, set->options+hi);
-			if (set->options[hi].r >= 0) {
-				break;
-			}
-		}
-		for (--hi; hi > lo; --hi) {
-			init_option(set->options+hi, 0, 0);
-			++set->skipped;
-		}
-		i = j;
+	if (options.unique) {
+		printf(" Answer %s", answer_names[get_answer(&stats)]);
 	}
-	while (i < options_n);
-	for (i = 0; i < options_n; ++i) {
-		if (set->options[i].r >= 0) {
-			set->color_cache[set->options[i].pos-set->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
-			set->options[set->options_n++] = set->options[i];
-		}
+	if (stats.aborted) {
+		printf(" Aborted %s", aborted_names[stats.aborted]);
 	}
-	set->others_n = set->options_n-set->solutions_n;
-	return options_n-set->options_n;
+	putchar('\n');
+	fflush(stdout);
+	return 1;
 }
 
-static void evaluate_option(set_t *set, option_t *option) {
-	set->color_cache[option->pos-set->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
-	++depth;
-	--negative_cache;
-	nonogram(set->clue, option);
-	++negative_cache;
-	--depth;
-	set->color_cache[option->pos-set->color_bounds_min[DEPTH_BCK]] = negative_cache;
-	if (option->r >= 0) {
-		set->solutions_n += option->r;
-		set->changes_sum += option->changes_sum;
+/* Prints the record of a puzzle that could not be read, the status is
+"invalid" or "error" so that each puzzle of a batch still has its record. */
+static void print_failure(const char *name, const char *status) {
+	nonogram_stats_t stats;
+	puzzle_name = name;
+	if (format != FORMAT_TEXT) {
+		memset(&stats, 0, sizeof(nonogram_stats_t));
+		width = 0;
+		height = 0;
+		colors_n = 0;
+		print_record(status, &stats, NULL);
+		return;
 	}
+	printf("Puzzle %s %c%s\n", name, toupper((unsigned char)*status), status+1);
+	fflush(stdout);
 }
 
-static set_t *init_set_min(set_t *set) {
-	if (verbose) {
-		printf("set_min %d %d %d %d\n", set->others_n, set->skipped, set->solutions_n, set->changes_sum);
-		fflush(stdout);
+/* Returns the position of the first character that is not blank from pos,
+size if only blanks are left in the text. */
+static size_t skip_blanks(const char *text, size_t size, size_t pos) {
+	while (pos < size && isspace((unsigned char)text[pos])) {
+		++pos;
 	}
-	return set;
+	return pos;
 }
 
-static int compare_evaluations(const set_t *set_a, const set_t *set_b) {
-	if (set_a->others_n != set_b->others_n) {
-		return set_a->others_n-set_b->others_n;
+static int print_solution(void *data, const nonogram_stats_t *stats, const char *grid) {
+	int i;
+	(void)data;
+	if (batch) {
+		return 1;
 	}
-	if (set_a->skipped != set_b->skipped) {
-		return set_a->skipped-set_b->skipped;
+	if (format != FORMAT_TEXT) {
+		print_record("solution", stats, grid);
+		return 1;
 	}
-	if (set_a->solutions_n != set_b->solutions_n) {
-		return set_b->solutions_n-set_a->solutions_n;
+	if (options.workers_n > 1) {
+		printf("\nDepth %d\n", stats->depth);
 	}
-	return set_b->changes_sum-set_a->changes_sum;
-}
-
-static int compare_options(const void *a, const void *b) {
-	const option_t *option_a = (const option_t *)a, *option_b = (const option_t *)b;
-	if (option_a->r != option_b->r) {
-		return option_a->r-option_b->r;
+	else {
+		printf("\nTime %.6fs\nAll nodes %" PRIu64 "\nRun nodes %" PRIu64 "\nFailures %" PRIu64 "\nDepth %d Completed %d\nCells %d Locked %u\n", stats->time, stats->all_nodes_n, stats->run_nodes_n, stats->failures_n, stats->depth, stats->completed_depth, stats->cells_n, stats->locked_cells_n);
 	}
-	if (option_a->changes_sum != option_b->changes_sum) {
-		return option_a->changes_sum-option_b->changes_sum;
+	for (i = 0; i < height; ++i) {
+		printf("%.*s\n", width, grid+i*width);
 	}
-	return option_b->pos-option_a->pos;
-}
-
-static void uncover_set(set_t *set) {
-	set->next->last = set;
-	set->last->next = set;
-}
-
-static void uncover_clue(clue_t *clue) {
-	clue->next->last = clue;
-	clue->last->next = clue;
-}
-
-static void uncover_cell(cell_t *cell) {
-	cell->row_next->row_last = cell;
-	cell->row_last->row_next = cell;
-	cell->column_next->column_last = cell;
-	cell->column_last->column_next = cell;
-	cell->color_cache[cell->color_pos-COLOR_POS_EMPTY] = CACHE_UNKNOWN;
-	cell->color_pos = COLOR_POS_UNKNOWN;
+	fflush(stdout);
+	return 1;
 }
 
-static void clear_set_negative_cache(const int *bounds_min, const int *bounds_max, int *cache) {
+/* Prints one record in the structured formats, the grid of a summary is the
+partial grid when the search was aborted and NULL otherwise. The rows of the
+grid are separated by a slash in CSV format. The answer is only known in the
+summary. */
+static void print_record(const char *record, const nonogram_stats_t *stats, const char *grid) {
 	int i;
-	for (i = bounds_min[depth+DEPTH_BCK]; i <= bounds_max[depth+DEPTH_BCK]; ++i) {
-		if (cache[i-bounds_min[DEPTH_BCK]] == negative_cache) {
-			cache[i-bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+	const char *answer = answer_names[strcmp(record, "summary") ? ANSWER_UNKNOWN:get_answer(stats)];
+	if (format == FORMAT_JSON) {
+		printf("{\"record\":\"%s\",\"puzzle\":", record);
+		print_json_string(puzzle_name);
+		printf(",\"width\":%d,\"height\":%d,\"colors\":%d,\"time\":%.6f,\"all_nodes\":%" PRIu64 ",\"run_nodes\":%" PRIu64 ",\"failures\":%" PRIu64 ",\"sweep_failures\":%" PRIu64 ",\"depth\":%d,\"max_depth\":%d,\"completed_depth\":%d,\"locked_cells\":%u,\"solutions\":%lu,\"answer\":\"%s\",\"aborted\":\"%s\",\"table_hits\":%" PRIu64 ",\"table_misses\":%" PRIu64 ",\"winner\":%d,\"strategy\":\"%s\",\"seed\":%" PRIu64 ",\"restarts\":%d,\"nogoods\":%" PRIu64 ",\"nogood_hits\":%" PRIu64, width, height, colors_n, stats->time, stats->all_nodes_n, stats->run_nodes_n, stats->failures_n, stats->sweep_failures_n, stats->depth, stats->max_depth, stats->completed_depth, stats->locked_cells_n, stats->solutions_n, answer, aborted_names[stats->aborted], stats->table_hits_n, stats->table_misses_n, stats->winner, strategy_names[stats->strategy], stats->seed, stats->restarts_n, stats->nogoods_n, stats->nogood_hits_n);
+		if (grid) {
+			fputs(",\"grid\":[", stdout);
+			for (i = 0; i < height; ++i) {
+				printf("%s\"%.*s\"", i ? ",":"", width, grid+i*width);
+			}
+			putchar(']');
 		}
+		puts("}");
 	}
-}
-
-static void init_empty_bounds(set_t *set, int pos, int bound_min) {
-	set->empty_bounds_min[pos] = bound_min;
-}
-
-static void init_color_bounds(set_t *set, int pos, int bound_min, int bound_max) {
-	set->color_bounds_min[pos] = bound_min;
-	set->color_bounds_max[pos] = bound_max;
-}
-
-static unsigned inc_with_limit(unsigned a) {
-	if (a < UINT_MAX) {
-		return a+1U;
-	}
-	return UINT_MAX;
-}
-
-static int sum_with_limit(int a, int b) {
-	if (a <= INT_MAX-b) {
-		return a+b;
-	}
-	return INT_MAX;
-}
-
-static void *alloc_mem(const char *name, size_t item_size, int items_n) {
-	void *mem = malloc(item_size*(size_t)items_n);
-	if (!mem) {
-		fprintf(stderr, "Could not allocate memory for %s\n", name);
-		fflush(stderr);
-	}
-	return mem;
-}
-
-static void *realloc_mem(const char *name, void *mem, size_t item_size, int items_n) {
-	void *reem = realloc(mem, item_size*(size_t)items_n);
-	if (!reem) {
-		fprintf(stderr, "Could not reallocate memory for %s\n", name);
-		fflush(stderr);
+	else {
+		printf("%s,", record);
+		print_csv_string(puzzle_name);
+		printf(",%d,%d,%d,%.6f,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%d,%d,%d,%u,%lu,%s,%s,%" PRIu64 ",%" PRIu64 ",%d,%s,%" PRIu64 ",%d,%" PRIu64 ",%" PRIu64 ",", width, height, colors_n, stats->time, stats->all_nodes_n, stats->run_nodes_n, stats->failures_n, stats->sweep_failures_n, stats->depth, stats->max_depth, stats->completed_depth, stats->locked_cells_n, stats->solutions_n, answer, aborted_names[stats->aborted], stats->table_hits_n, stats->table_misses_n, stats->winner, strategy_names[stats->strategy], stats->seed, stats->restarts_n, stats->nogoods_n, stats->nogood_hits_n);
+		if (grid) {
+			putchar('"');
+			for (i = 0; i < height; ++i) {
+				printf("%s%.*s", i ? "/":"", width, grid+i*width);
+			}
+			putchar('"');
+		}
+		putchar('\n');
 	}
-	return reem;
+	fflush(stdout);
 }
 
-static void free_data(int cells_max, int clues_max) {
-	if (locked_cells) {
-		free(locked_cells);
-	}
-	if (locked_clues) {
-		free(locked_clues);
-	}
-	if (sorted_clues) {
-		free(sorted_clues);
-	}
-	if (locked_sets) {
-		free(locked_sets);
-	}
-	if (sorted_sets) {
-		free(sorted_sets);
-	}
-	if (cells) {
-		int i;
-		for (i = cells_max; i--; ) {
-			free_cell(cells+i);
+static void print_json_string(const char *str) {
+	putchar('"');
+	for (; *str; ++str) {
+		if (*str == '"' || *str == '\\') {
+			printf("\\%c", *str);
 		}
-		free(cells);
-	}
-	if (clues) {
-		int i;
-		for (i = clues_max; i--; ) {
-			free_clue(clues+i, clues[i].sets_n+1);
+		else if ((unsigned char)*str < ' ') {
+			printf("\\u%04x", (unsigned)(unsigned char)*str);
+		}
+		else {
+			putchar(*str);
 		}
-		free(clues);
 	}
-	free(colors);
+	putchar('"');
 }
 
-static void free_cell(cell_t *cell) {
-	free(cell->color_cache);
+static void print_csv_string(const char *str) {
+	putchar('"');
+	for (; *str; ++str) {
+		if (*str == '"') {
+			putchar('"');
+		}
+		putchar(*str);
+	}
+	putchar('"');
 }
 
-static void free_clue(clue_t *clue, int sets_max) {
+/* The cells that are not locked in the partial grid are printed as unknown. */
+static void print_partial_grid(nonogram_t *puzzle, const nonogram_stats_t *stats) {
 	int i;
-	for (i = sets_max; i--; ) {
-		free_set(clue->sets+i);
+	const char *grid = nonogram_partial_grid(puzzle);
+	if (!grid) {
+		return;
 	}
-	free(clue->sets);
-}
-
-static void free_set(set_t *set) {
-	if (set->options) {
-		free(set->options);
-		set->options = NULL;
+	printf("Aborted %s\n", aborted_names[stats->aborted]);
+	for (i = 0; i < height; ++i) {
+		printf("%.*s\n", width, grid+i*width);
 	}
-	free_ints(&set->color_cache);
-	free_ints(&set->empty_cache);
-	free_ints(&set->color_bounds_max);
-	free_ints(&set->color_bounds_min);
-	free_ints(&set->empty_bounds_min);
 }
 
-static void free_ints(int **ints) {
-	if (*ints) {
-		free(*ints);
-		*ints = NULL;
+/* The puzzle is unique when the search completed with one solution while it
+could look for a second one. */
+static int get_answer(const nonogram_stats_t *stats) {
+	if (stats->solutions_n > 1UL) {
+		return ANSWER_MULTIPLE;
+	}
+	if (stats->aborted || (stats->solutions_n && !options.unique && options.solutions_max < 2UL)) {
+		return ANSWER_UNKNOWN;
 	}
+	return stats->solutions_n ? ANSWER_UNIQUE:ANSWER_NONE;
 }
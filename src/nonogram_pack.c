@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "nonogram_solver.h"
+
+#define FILENAME_SIZE 4096
+#define NAME_SIZE (FILENAME_SIZE+32)
+#define TEXT_BLOCK 65536
+#define PUZZLES_MAX UINT32_MAX
+
+static int pack_file(FILE *, nonogram_t *, const char *);
+static int write_record(FILE *, nonogram_t *, const char *);
+static int read_file(const char *, size_t *);
+static size_t skip_blanks(size_t, size_t);
+static int write_uint(FILE *, uint64_t, int);
+
+static size_t text_size, record_size, offsets_size, offsets_n;
+static char *text;
+static unsigned char *record;
+static uint64_t offset, *offsets;
+
+int main(int argc, char *argv[]) {
+	char filename[FILENAME_SIZE];
+	int errors_n = 0;
+	FILE *pack;
+	nonogram_t *puzzle;
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <pack file> (the puzzle file names are read from the standard input, one per line)\n", argv[0]);
+		fflush(stderr);
+		return EXIT_FAILURE;
+	}
+	pack = fopen(argv[1], "wb");
+	if (!pack) {
+		fprintf(stderr, "Could not open %s\n", argv[1]);
+		fflush(stderr);
+		return EXIT_FAILURE;
+	}
+	puzzle = nonogram_create();
+	if (!puzzle) {
+		fclose(pack);
+		return EXIT_FAILURE;
+	}
+	offset = NONOGRAM_PACK_HEADER_SIZE;
+	if (fseek(pack, (long)offset, SEEK_SET)) {
+		errors_n = -1;
+	}
+	while (errors_n >= 0 && fgets(filename, FILENAME_SIZE, stdin)) {
+		filename[strcspn(filename, "\r\n")] = '\0';
+		if (!filename[0]) {
+			continue;
+		}
+		switch (pack_file(pack, puzzle, filename)) {
+		case 0:
+			++errors_n;
+			break;
+		case -1:
+			errors_n = -1;
+			break;
+		default:
+			break;
+		}
+	}
+	nonogram_destroy(puzzle);
+	free(text);
+	free(record);
+
+	/* The index is written after the records, and the header last when the
+	number of puzzles and the offset of the index are known. */
+	if (errors_n >= 0) {
+		size_t i;
+		uint64_t index = offset;
+		for (i = 0; i < offsets_n && write_uint(pack, offsets[i], 8); ++i);
+		if (i < offsets_n || !write_uint(pack, offset, 8) || fseek(pack, 0L, SEEK_SET) || fwrite(NONOGRAM_PACK_MAGIC, strlen(NONOGRAM_PACK_MAGIC), 1, pack) != 1 || !write_uint(pack, (uint64_t)offsets_n, 4) || !write_uint(pack, index, 8)) {
+			errors_n = -1;
+		}
+	}
+	free(offsets);
+	if (fclose(pack) || errors_n < 0) {
+		fprintf(stderr, "Could not write %s\n", argv[1]);
+		fflush(stderr);
+		return EXIT_FAILURE;
+	}
+	printf("Puzzles %lu Errors %d Size %" PRIu64 "\n", (unsigned long)offsets_n, errors_n, offset+(uint64_t)(offsets_n+1)*8);
+	fflush(stdout);
+	return errors_n ? EXIT_FAILURE:EXIT_SUCCESS;
+}
+
+/* Adds all the puzzles of a text file, they are named after the file with
+their number appended when there are several. Returns -1 if the pack could
+not be written, 0 if the file holds an invalid puzzle. */
+static int pack_file(FILE *pack, nonogram_t *puzzle, const char *filename) {
+	char name[NAME_SIZE];
+	size_t size, pos, used;
+	unsigned long puzzles_n = 0UL;
+	if (!read_file(filename, &size)) {
+		return 0;
+	}
+	pos = skip_blanks(0, size);
+	do {
+		int r;
+		if (!nonogram_parse(puzzle, text+pos, size-pos, &used)) {
+			fprintf(stderr, "Invalid puzzle %lu in %s\n", puzzles_n+1UL, filename);
+			fflush(stderr);
+			return 0;
+		}
+		pos = skip_blanks(pos+used, size);
+		++puzzles_n;
+		if (puzzles_n == 1UL && pos == size) {
+			strcpy(name, filename);
+		}
+		else {
+			sprintf(name, "%s:%lu", filename, puzzles_n);
+		}
+		r = write_record(pack, puzzle, name);
+		if (r <= 0) {
+			return r;
+		}
+	}
+	while (pos < size);
+	return 1;
+}
+
+/* The number of puzzles is written on 4 bytes in the header, a record past
+the largest number is refused. */
+static int write_record(FILE *pack, nonogram_t *puzzle, const char *name) {
+	size_t name_size = strlen(name)+1, size;
+	if ((uint64_t)offsets_n == PUZZLES_MAX) {
+		fprintf(stderr, "Too many puzzles, %s is not added\n", name);
+		fflush(stderr);
+		return -1;
+	}
+	size = nonogram_encode(puzzle, record, record_size);
+	if (size > record_size) {
+		unsigned char *record_tmp = realloc(record, size);
+		if (!record_tmp) {
+			fputs("Could not reallocate memory for record\n", stderr);
+			fflush(stderr);
+			return -1;
+		}
+		record = record_tmp;
+		record_size = size;
+		nonogram_encode(puzzle, record, record_size);
+	}
+	if (offsets_n == offsets_size) {
+		size_t offsets_size_tmp = offsets_size ? offsets_size*2:1024;
+		uint64_t *offsets_tmp = realloc(offsets, sizeof(uint64_t)*offsets_size_tmp);
+		if (!offsets_tmp) {
+			fputs("Could not reallocate memory for offsets\n", stderr);
+			fflush(stderr);
+			return -1;
+		}
+		offsets = offsets_tmp;
+		offsets_size = offsets_size_tmp;
+	}
+	if (fwrite(name, name_size, 1, pack) != 1 || fwrite(record, size, 1, pack) != 1) {
+		return -1;
+	}
+	offsets[offsets_n++] = offset;
+	offset += (uint64_t)(name_size+size);
+	return 1;
+}
+
+/* The whole file is read in the text buffer, that is grown by blocks. */
+static int read_file(const char *filename, size_t *size) {
+	size_t read_n;
+	FILE *input = fopen(filename, "r");
+	if (!input) {
+		fprintf(stderr, "Could not open %s\n", filename);
+		fflush(stderr);
+		return 0;
+	}
+	*size = 0;
+	do {
+		if (text_size-*size < TEXT_BLOCK) {
+			char *text_tmp = realloc(text, text_size+TEXT_BLOCK);
+			if (!text_tmp) {
+				fputs("Could not reallocate memory for text\n", stderr);
+				fflush(stderr);
+				fclose(input);
+				return 0;
+			}
+			text = text_tmp;
+			text_size += TEXT_BLOCK;
+		}
+		read_n = fread(text+*size, 1, text_size-*size, input);
+		*size += read_n;
+	}
+	while (read_n > 0);
+	fclose(input);
+	return 1;
+}
+
+static size_t skip_blanks(size_t pos, size_t size) {
+	while (pos < size && isspace((unsigned char)text[pos])) {
+		++pos;
+	}
+	return pos;
+}
+
+static int write_uint(FILE *pack, uint64_t value, int bytes_n) {
+	unsigned char bytes[8];
+	int i;
+	for (i = 0; i < bytes_n; ++i) {
+		bytes[i] = (unsigned char)(value & 0xffU);
+		value >>= 8;
+	}
+	return fwrite(bytes, (size_t)bytes_n, 1, pack) == 1;
+}
@@ -0,0 +1,4355 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "nonogram_solver.h"
+
+#define SEPARATOR_CLUES ','
+#define SEPARATOR_LINES '\n'
+#define DELIMITER_CLUE '\"'
+#define SEPARATOR_COLOR '-'
+#define SEPARATOR_SETS ','
+#define COLOR_UNKNOWN '?'
+#define COLOR_SEVERAL '!'
+#define COLOR_EMPTY ' '
+#define COLOR_BLACK '*'
+#define COLOR_POS_UNKNOWN 0
+#define COLOR_POS_SEVERAL 1
+#define COLOR_POS_EMPTY 2
+#define COLOR_POS_BLACK 3
+#define COLORS_MAX (COLOR_POS_EMPTY+64)
+#define TEXT_SIZE_MIN 4096
+#define DEPTH_CUR 0
+#define DEPTH_BCK 1
+#define DEPTHS_SIZE 2
+#define CACHE_UNKNOWN 0
+#define CACHE_CONFIRMED 1
+#define STEAL_WAIT_NS 100000L
+#define LINE_BITS_MAX 127
+#define PHASE_SWEEP 0
+#define PHASE_PROBE 1
+#define PHASE_SELECT 2
+#define PHASE_BACKTRACK 3
+#define PHASE_LEARN 4
+#define PHASES_N 5
+#define ABORT_PORTFOLIO (NONOGRAM_ABORT_MEMORY+1)
+#define ABORT_RESTART (NONOGRAM_ABORT_MEMORY+2)
+#define CHECKPOINT_MAGIC UINT64_C(0x354b43474f4e4f4e)
+#define CHECKPOINT_SETTINGS 13
+#define CHECKPOINT_SETTINGS_N 7
+#define CHECKPOINT_HEADER_N (CHECKPOINT_SETTINGS+CHECKPOINT_SETTINGS_N)
+#define FNV_OFFSET UINT64_C(0xcbf29ce484222325)
+#define FNV_PRIME UINT64_C(0x100000001b3)
+#define HASH_CELL UINT64_C(0x9e3779b97f4a7c15)
+#define HASH_CLUE UINT64_C(0xd6e8feb86659fd93)
+#define HASH_MARK UINT64_C(0xc2b2ae3d27d4eb4f)
+#define HASH_PROBE UINT64_C(0x165667b19e3779f9)
+#define TABLE_ENTRIES_MAX 0x40000000UL
+#define NOGOOD_SIZE_MAX 8
+#define NOGOOD_CHECKS_MAX 20
+
+typedef unsigned __int128 bits_t;
+
+/* Position of the tokenizer in the text of a puzzle, the line and column of
+the last token are only kept for the error messages. */
+typedef struct {
+	const char *text;
+	size_t size;
+	size_t pos;
+	size_t line_start;
+	int line;
+	int column;
+}
+parser_t;
+
+typedef struct {
+	uint64_t phase_calls_n[PHASES_N];
+	uint64_t phase_ns[PHASES_N];
+	uint64_t empty_cache_lookups_n;
+	uint64_t empty_cache_hits_n;
+	uint64_t color_cache_lookups_n;
+	uint64_t color_cache_hits_n;
+	uint64_t table_hits_n;
+	uint64_t table_misses_n;
+	uint64_t sweep_failures_n;
+	uint64_t nogoods_n;
+	uint64_t nogood_hits_n;
+}
+counters_t;
+
+typedef struct {
+	int pos;
+	int r;
+	int changes_sum;
+	unsigned tie;
+}
+option_t;
+
+typedef struct set_s set_t;
+typedef struct clue_s clue_t;
+typedef struct cell_s cell_t;
+typedef struct worker_s worker_t;
+typedef struct pool_s pool_t;
+typedef struct member_s member_t;
+typedef struct portfolio_s portfolio_t;
+
+struct set_s {
+	int len;
+	int color_pos;
+	clue_t *clue;
+	int empty_before;
+
+	/* Left-most and right-most starts of the colored cells found by the
+	rules applied before the first sweep. */
+	int overlap_min;
+	int overlap_max;
+	int *empty_bounds_min;
+	int *color_bounds_min;
+	int *color_bounds_max;
+	int *empty_cache;
+	int *color_cache;
+	int options_n;
+	option_t *options;
+	int solutions_n;
+	int changes_sum;
+	int skipped;
+	int others_n;
+	uint64_t probed;
+	uint64_t *swept_clues;
+	uint64_t tie;
+	set_t *last;
+	set_t *next;
+};
+
+struct clue_s {
+	int pos;
+	int sets_n;
+	int sets_size;
+	set_t *sets;
+	set_t *sets_header;
+	int relaxation;
+	int depths_size;
+	int bounds_size;
+	int *bounds;
+	int priority;
+	int swept;
+	int queue_pos;
+	uint64_t removed;
+	uint64_t failures;
+	int saved_depth;
+	cell_t *cells_header;
+	clue_t *last;
+	clue_t *next;
+};
+
+struct cell_s {
+	clue_t *column_clue;
+	clue_t *row_clue;
+	int color_pos;
+	uint64_t colors;
+	uint64_t confirmed;
+	cell_t *column_last;
+	cell_t *column_next;
+	cell_t *row_last;
+	cell_t *row_next;
+};
+
+/* Colors of a cell before some were removed, put back when the search leaves
+the node. */
+typedef struct {
+	cell_t *cell;
+	uint64_t colors;
+}
+trail_t;
+
+/* Depth of the node that saved the clue before, put back with its bounds. */
+typedef struct {
+	clue_t *clue;
+	int saved_depth;
+}
+saved_clue_t;
+
+/* Search state of one depth, the set is NULL when the node does not branch. */
+typedef struct {
+	set_t *set_min;
+	int rank;
+	int probes_limit;
+	unsigned locked_cells_n_bak;
+	unsigned locked_clues_n_bak;
+	unsigned locked_sets_n_bak;
+	int trail_n_bak;
+	int saved_clues_n_bak;
+	uint64_t hash_bak;
+}
+frame_t;
+
+/* Result of a probe, the key is the hash of the node with the probed option.
+The clues swept by the probe are kept in the table of the context at the same
+index, the failed clue is -1 when the probe did not fail. */
+typedef struct {
+	uint64_t key;
+	int r;
+	int changes_sum;
+	int failed_clue;
+}
+table_entry_t;
+
+/* Position of a set in its line, the set is given by the position of its clue
+and its index in the clue so that it can be found in another context. */
+typedef struct {
+	int clue;
+	int set;
+	int pos;
+}
+placement_t;
+
+/* Placements that cannot all hold in a solution. Each one is linked in the
+bucket of the table that matches its hash, the links are the index of the
+nogood times NOGOOD_SIZE_MAX plus the index of the placement. The activity is
+the stamp of the last hit. */
+typedef struct {
+	int placements_n;
+	placement_t placements[NOGOOD_SIZE_MAX];
+	int next[NOGOOD_SIZE_MAX];
+	int last[NOGOOD_SIZE_MAX];
+	uint64_t activity;
+}
+nogood_t;
+
+/* State of the search at the entry of a run node, the path holds the rank of
+the option searched at each depth above it followed by the limits of the
+adaptive strategy at these depths and at the run node. */
+typedef struct {
+	uint64_t time_ns;
+	uint64_t all_nodes_n;
+	uint64_t run_nodes_n;
+	uint64_t failures_n;
+	uint64_t sweep_failures_n;
+	uint64_t solutions_n;
+	uint64_t table_hits_n;
+	uint64_t table_misses_n;
+	int max_depth;
+	int completed_depth;
+	int depth;
+	int *path;
+	int *limits;
+}
+checkpoint_t;
+
+typedef struct {
+	int depth;
+	int *path;
+	char *grid;
+}
+solution_t;
+
+struct worker_s {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pool_t *pool;
+	nonogram_t *ctx;
+	int busy;
+	int base_depth;
+	int ranged;
+	int rank_min;
+	int top;
+	int *path;
+	int *ranks_end;
+	int *limits;
+	uint64_t all_nodes_n;
+	uint64_t run_nodes_n;
+	uint64_t failures_n;
+	int max_depth;
+	counters_t counters;
+};
+
+struct pool_s {
+	pthread_mutex_t mutex;
+	pthread_mutex_t report_mutex;
+	worker_t *workers;
+	int workers_n;
+	int idle_n;
+	int done;
+	int error;
+	int aborted;
+	int multiple;
+	int version;
+	uint64_t all_nodes_n;
+	size_t memory_size;
+	unsigned long solutions_max;
+	unsigned long reported_n;
+	unsigned long solutions_n;
+	unsigned long solutions_size;
+	solution_t *solutions;
+	nonogram_callback_t callback;
+	void *data;
+};
+
+struct member_s {
+	pthread_t thread;
+	portfolio_t *portfolio;
+	nonogram_t *ctx;
+	int index;
+	int error;
+	unsigned long solutions_n;
+	unsigned long solutions_size;
+	solution_t *solutions;
+};
+
+struct portfolio_s {
+	member_t *members;
+	int members_n;
+	int winner;
+};
+
+struct nonogram_s {
+	int loaded, width, height, colors_size, colors_n, *colors, clues_size, clues_n, cells_size, sets_size, sets_n, grid_size, depth, max_depth, completed_depth, negative_cache, offset;
+	unsigned locked_cells_n, locked_clues_n, locked_sets_n;
+	uint64_t all_nodes_n, run_nodes_n, failures_n, nodes_max;
+	double time_max;
+	size_t memory_max, memory_size;
+	int aborted, unique;
+	unsigned long solutions_max, solutions_n;
+	uint64_t time_zero;
+	FILE *input, *trace, *profile;
+	size_t text_size;
+	char *text;
+	const char *checkpoint;
+	double checkpoint_period, checkpoint_time;
+	checkpoint_t resume;
+	counters_t counters;
+	nonogram_callback_t callback;
+	void *data;
+	char *grid;
+	set_t **sorted_sets, **locked_sets;
+	frame_t *frames;
+	clue_t *clues, *clues_header, **queued_clues, **locked_clues, *current_clue;
+	cell_t *cells, **locked_cells;
+	pool_t *pool;
+	worker_t *worker;
+	member_t *member;
+	uint64_t seed, restart_nodes, restart_start;
+	int restarts_n;
+	int threshold_version, threshold_depth, *threshold_path;
+	size_t arena_size, arena_used;
+	char *arena;
+	int line_bits_n;
+	bits_t *line_bits;
+	int trail_size, trail_n;
+	trail_t *trail;
+	int saved_clues_size, saved_clues_n;
+	saved_clue_t *saved_clues;
+	size_t table_bytes, table_size;
+	table_entry_t *table;
+	int table_words_n;
+	uint64_t *table_clues, *probe_clues, table_seed, hash, probe_key;
+	int queued_clues_n, strategy, probes_max, probes_limit, probes_budget, node_probes_n, clue_words_n;
+	uint64_t probes_stamp, *swept_clues;
+	int nogoods_max, nogoods_size, nogoods_n, buckets_n, *buckets, placements_size;
+	nogood_t *nogoods;
+	placement_t *placements;
+	uint64_t nogoods_stamp;
+	nonogram_t *checker;
+};
+
+static void init_data(nonogram_t *);
+static int read_text(nonogram_t *, size_t *);
+static int parse_puzzle(nonogram_t *, parser_t *);
+static int decode_puzzle(nonogram_t *, const unsigned char *, size_t);
+static int copy_puzzle(nonogram_t *, const nonogram_t *);
+static int build_puzzle(nonogram_t *);
+static int reserve_colors(nonogram_t *);
+static int reserve_clues(nonogram_t *);
+static int reserve_clue_sets(clue_t *, int);
+static int reserve_cells(nonogram_t *);
+static int reserve_sets(nonogram_t *);
+static int reserve_arena(nonogram_t *);
+static void *arena_alloc(nonogram_t *, size_t, int);
+static void init_search(nonogram_t *);
+static void init_ties(nonogram_t *);
+static void run_search(nonogram_t *);
+static int check_restart(nonogram_t *);
+static uint64_t get_luby(int);
+static void report_solution(nonogram_t *);
+static void report_multiple(nonogram_t *);
+static void fill_stats(const nonogram_t *, nonogram_stats_t *);
+static uint64_t get_clock_ns(void);
+static double get_time(const nonogram_t *);
+static void add_phase(nonogram_t *, int, uint64_t);
+static void add_counters(counters_t *, const counters_t *);
+static void report_profile(const nonogram_t *);
+static size_t get_memory_size(const nonogram_t *);
+static void add_memory(nonogram_t *, size_t);
+static int check_budget(nonogram_t *);
+static void abort_search(nonogram_t *, int);
+static int reserve_table(nonogram_t *);
+static int reserve_nogoods(nonogram_t *);
+static int init_checker(nonogram_t *);
+static void learn_nogood(nonogram_t *, const set_t *);
+static int check_placements(nonogram_t *, const placement_t *, int, const set_t *);
+static int push_placement(nonogram_t *, const placement_t *);
+static void pop_placement(nonogram_t *);
+static int check_set_failed(nonogram_t *, const set_t *);
+static void store_nogood(nonogram_t *, const placement_t *, int);
+static void unlink_placement(nonogram_t *, int);
+static int check_nogoods(nonogram_t *, const set_t *, int);
+static void init_placement(placement_t *, const set_t *, int);
+static set_t *get_placement_set(const nonogram_t *, const placement_t *);
+static int get_bucket(const nonogram_t *, const placement_t *);
+static uint64_t hash_puzzle(const nonogram_t *);
+static uint64_t hash_int(uint64_t, int);
+static void get_settings(const nonogram_t *, uint64_t *);
+static void write_checkpoint(nonogram_t *);
+static int read_checkpoint(nonogram_t *, const char *);
+static void resume_search(nonogram_t *);
+static void copy_settings(nonogram_t *, const nonogram_t *);
+static int solve_workers(nonogram_t *, int, nonogram_stats_t *);
+static void *run_worker(void *);
+static int alloc_worker_paths(nonogram_t *);
+static void free_worker_paths(nonogram_t *);
+static void leave_task(nonogram_t *);
+static int steal_task(nonogram_t *);
+static int steal_frame(nonogram_t *, worker_t *);
+static int open_frame(nonogram_t *, int, int);
+static void enter_frame(nonogram_t *, int);
+static int get_rank_end(nonogram_t *);
+static void close_frame(nonogram_t *);
+static int prune_worker(nonogram_t *);
+static void record_solution(nonogram_t *);
+static void report_solutions(nonogram_t *, pool_t *);
+static int check_solution_first(const pool_t *, const solution_t *);
+static int compare_paths(int, const int *, int, const int *);
+static void abort_workers(nonogram_t *);
+static int solve_portfolio(nonogram_t *, int, nonogram_stats_t *);
+static void *run_member(void *);
+static int collect_solution(void *, const nonogram_stats_t *, const char *);
+static int parse_clue(nonogram_t *, parser_t *, clue_t *, int, int);
+static int parse_int(parser_t *, int *);
+static int next_char(parser_t *);
+static int parse_error(const parser_t *, const char *);
+static size_t encode_int(unsigned char *, size_t, size_t, int);
+static int decode_int(const unsigned char *, size_t, size_t *, int *);
+static int init_clue(nonogram_t *, clue_t *);
+static size_t get_clue_tables_size(const clue_t *);
+static int init_clue_tables(nonogram_t *, clue_t *);
+static void init_set_fields(set_t *, int, int, clue_t *);
+static void init_set_tables(nonogram_t *, set_t *, int, int, int, int);
+static void link_set(set_t *, set_t *, set_t *);
+static void link_clue(clue_t *, clue_t *, clue_t *);
+static void init_cell(nonogram_t *, cell_t *, clue_t *, clue_t *);
+static void link_column_clue(nonogram_t *, clue_t *, cell_t *);
+static void link_column_cell(cell_t *, cell_t *, cell_t *);
+static void link_row_clue(nonogram_t *, clue_t *, cell_t *);
+static void link_row_cell(cell_t *, cell_t *, cell_t *);
+static int sweep_node(nonogram_t *, clue_t *, option_t *, frame_t *);
+static int load_probe(nonogram_t *, option_t *);
+static void store_probe(nonogram_t *, const option_t *, const clue_t *);
+static void init_frame(nonogram_t *, frame_t *);
+static void nonogram(nonogram_t *);
+static void enter_node(nonogram_t *, clue_t *, frame_t *);
+static int get_probes_n(const nonogram_t *, int);
+static void update_probes_limit(nonogram_t *, int);
+static void leave_node(nonogram_t *, const frame_t *);
+static void init_option(option_t *, int, int);
+static int reallocate_bounds(nonogram_t *, clue_t *, int);
+static int reserve_saved_clues(nonogram_t *, int);
+static void save_clue(nonogram_t *, clue_t *);
+static void restore_clue(nonogram_t *, const saved_clue_t *);
+static void link_bounds(clue_t *);
+static int compare_priorities(const void *, const void *);
+static void push_clue(nonogram_t *, clue_t *, int);
+static clue_t *pop_clue(nonogram_t *);
+static int overlap_clue(nonogram_t *, clue_t *);
+static int check_set_fit(const nonogram_t *, const set_t *, const cell_t *, int, int);
+static int sweep_clue(nonogram_t *, set_t *, int, cell_t *);
+static int sweep_set(nonogram_t *, set_t *, int, cell_t *, cell_t **, int *);
+static int get_clue_slack(const clue_t *);
+static int get_fixed_sets_n(const clue_t *, int *);
+static int sweep_line_bits(nonogram_t *, clue_t *, cell_t *, int);
+static int reach_line_bits(int, int, const set_t *, int, bits_t, bits_t, bits_t *, bits_t *);
+static bits_t close_bits(bits_t, bits_t);
+static bits_t fit_bits(bits_t, int);
+static bits_t dilate_bits(bits_t, int);
+static bits_t reverse_bits(bits_t, int);
+static uint64_t reverse_word(uint64_t);
+static int reserve_trail(nonogram_t *, int);
+static int check_cell_colors(nonogram_t *, cell_t *);
+static void update_empty_bound_and_cache(int *, const int *, int *);
+static void update_color_bounds_and_cache(int *, int *, int *);
+static void clear_set_positive_cache(const int *, const int *, int *);
+static int compare_sets(const void *, const void *);
+static int evaluate_set(nonogram_t *, set_t *);
+static void evaluate_option(nonogram_t *, set_t *, option_t *);
+static void remove_option(nonogram_t *, set_t *, int);
+static set_t *init_set_min(nonogram_t *, set_t *);
+static int check_set_stale(const nonogram_t *, const set_t *);
+static int compare_evaluations(const set_t *, const set_t *);
+static int compare_options(const void *, const void *);
+static void uncover_set(set_t *);
+static void uncover_clue(clue_t *);
+static void uncover_cell(cell_t *);
+static uint64_t hash_cell(const nonogram_t *, const cell_t *, uint64_t);
+static uint64_t hash_option(const set_t *, int, uint64_t);
+static uint64_t mix_hash(uint64_t);
+static void clear_set_negative_cache(nonogram_t *, const int *, const int *, int *);
+static void init_empty_bounds(set_t *, int, int);
+static void init_color_bounds(set_t *, int, int, int);
+static int sum_with_limit(int, int);
+static void *alloc_mem(const char *, size_t, int);
+static void *realloc_mem(const char *, void *, size_t, int);
+static void free_data(nonogram_t *);
+static void free_ints(int **);
+
+void nonogram_init_options(nonogram_options_t *options) {
+	options->solutions_max = ULONG_MAX;
+	options->unique = 0;
+	options->nodes_max = UINT64_MAX;
+	options->time_max = 0.0;
+	options->memory_max = 0;
+	options->table_size = 0;
+	options->strategy = NONOGRAM_STRATEGY_PROBE;
+	options->probes_max = 8;
+	options->probes_budget = 0;
+	options->workers_n = 1;
+	options->portfolio_n = 1;
+	options->seed = 0;
+	options->restart_nodes = 0;
+	options->nogoods_max = 0;
+	options->trace = NULL;
+	options->profile = NULL;
+	options->checkpoint = NULL;
+	options->checkpoint_period = 60.0;
+	options->resume = NULL;
+}
+
+nonogram_t *nonogram_create(void) {
+	nonogram_t *ctx = alloc_mem("nonogram", sizeof(nonogram_t), 1);
+	if (!ctx) {
+		return NULL;
+	}
+	ctx->loaded = 0;
+	init_data(ctx);
+	ctx->pool = NULL;
+	ctx->worker = NULL;
+	ctx->member = NULL;
+	ctx->unique = 0;
+	ctx->seed = 0;
+	ctx->restart_nodes = 0;
+	ctx->nogoods_max = 0;
+	ctx->checkpoint = NULL;
+	ctx->resume.depth = 0;
+	ctx->resume.path = NULL;
+	ctx->resume.limits = NULL;
+	return ctx;
+}
+
+/* The buffers of the previous puzzle are kept and only grown when needed, so
+a context may be reused to load many puzzles without allocating again. */
+int nonogram_load(nonogram_t *ctx, FILE *input) {
+	size_t size, used;
+	ctx->input = input;
+	if (!read_text(ctx, &size)) {
+		ctx->loaded = 0;
+		return 0;
+	}
+	return nonogram_parse(ctx, ctx->text, size, &used);
+}
+
+int nonogram_parse(nonogram_t *ctx, const char *text, size_t size, size_t *used) {
+	parser_t parser;
+	parser.text = text;
+	parser.size = size;
+	parser.pos = 0;
+	parser.line_start = 0;
+	parser.line = 1;
+	parser.column = 1;
+	ctx->loaded = parse_puzzle(ctx, &parser);
+	*used = parser.pos;
+	return ctx->loaded;
+}
+
+int nonogram_decode(nonogram_t *ctx, const unsigned char *data, size_t size) {
+	ctx->loaded = decode_puzzle(ctx, data, size);
+	if (!ctx->loaded) {
+		fputs("Invalid binary puzzle\n", stderr);
+		fflush(stderr);
+	}
+	return ctx->loaded;
+}
+
+size_t nonogram_encode(const nonogram_t *ctx, unsigned char *data, size_t size) {
+	int i;
+	size_t pos;
+	if (!ctx->loaded) {
+		return 0;
+	}
+	pos = encode_int(data, size, 0, ctx->width);
+	pos = encode_int(data, size, pos, ctx->height);
+	pos = encode_int(data, size, pos, ctx->colors_n-COLOR_POS_BLACK);
+	for (i = COLOR_POS_BLACK; i < ctx->colors_n; ++i) {
+		pos = encode_int(data, size, pos, ctx->colors[i]);
+	}
+	for (i = 0; i < ctx->clues_n; ++i) {
+		int j;
+		pos = encode_int(data, size, pos, ctx->clues[i].sets_n);
+		for (j = 0; j < ctx->clues[i].sets_n; ++j) {
+			pos = encode_int(data, size, pos, ctx->clues[i].sets[j].len);
+			if (ctx->colors_n > COLOR_POS_BLACK+1) {
+				pos = encode_int(data, size, pos, ctx->clues[i].sets[j].color_pos-COLOR_POS_BLACK);
+			}
+		}
+	}
+	return pos;
+}
+
+int nonogram_width(const nonogram_t *ctx) {
+	return ctx->width;
+}
+
+int nonogram_height(const nonogram_t *ctx) {
+	return ctx->height;
+}
+
+const char *nonogram_partial_grid(const nonogram_t *ctx) {
+	return ctx->aborted ? ctx->grid:NULL;
+}
+
+int nonogram_colors(const nonogram_t *ctx) {
+	return ctx->colors_n-COLOR_POS_EMPTY;
+}
+
+int nonogram_solve(nonogram_t *ctx, const nonogram_options_t *options, nonogram_callback_t callback, void *data, nonogram_stats_t *stats) {
+	if (!ctx->loaded) {
+		fputs("No puzzle loaded\n", stderr);
+		fflush(stderr);
+		return 0;
+	}
+	ctx->unique = options->unique;
+	ctx->solutions_max = options->unique ? 2UL:options->solutions_max;
+	ctx->nodes_max = options->nodes_max;
+	ctx->time_max = options->time_max;
+	ctx->memory_max = options->memory_max;
+	ctx->trace = options->trace;
+	ctx->profile = options->profile;
+	ctx->callback = options->unique ? NULL:callback;
+	ctx->data = data;
+	ctx->time_zero = get_clock_ns();
+	ctx->table_bytes = options->table_size/(size_t)options->workers_n/(size_t)options->portfolio_n;
+	ctx->strategy = options->strategy;
+	ctx->probes_max = options->probes_max;
+	ctx->probes_budget = options->probes_budget;
+	ctx->seed = options->seed;
+	ctx->restart_nodes = options->restart_nodes;
+	ctx->nogoods_max = options->nogoods_max;
+	if (options->nogoods_max < 0) {
+		fputs("Invalid number of nogoods\n", stderr);
+		fflush(stderr);
+		return 0;
+	}
+	if (options->nogoods_max && (options->workers_n > 1 || options->checkpoint || options->resume)) {
+		fputs("Nogoods need a single worker and no checkpoint\n", stderr);
+		fflush(stderr);
+		return 0;
+	}
+	if (options->portfolio_n > 1) {
+		if (options->workers_n > 1 || options->checkpoint || options->resume) {
+			fputs("The portfolio members need a single worker and no checkpoint\n", stderr);
+			fflush(stderr);
+			return 0;
+		}
+		if (!solve_portfolio(ctx, options->portfolio_n, stats)) {
+			return 0;
+		}
+	}
+	else if (options->workers_n > 1) {
+		if (options->checkpoint || options->resume || options->restart_nodes) {
+			fputs("Checkpoints and restarts need a single worker\n", stderr);
+			fflush(stderr);
+			return 0;
+		}
+		if (!reserve_nogoods(ctx) || !solve_workers(ctx, options->workers_n, stats)) {
+			return 0;
+		}
+	}
+	else {
+		if (options->restart_nodes && (options->checkpoint || options->resume)) {
+			fputs("Restarts cannot be used with checkpoints\n", stderr);
+			fflush(stderr);
+			return 0;
+		}
+		init_search(ctx);
+		if (!reserve_table(ctx) || !reserve_nogoods(ctx) || (options->resume && !read_checkpoint(ctx, options->resume))) {
+			return 0;
+		}
+		ctx->checkpoint = options->checkpoint;
+		ctx->checkpoint_period = options->checkpoint_period;
+		ctx->checkpoint_time = get_time(ctx)+ctx->checkpoint_period;
+		add_memory(ctx, get_memory_size(ctx));
+		run_search(ctx);
+		ctx->checkpoint = NULL;
+		free_ints(&ctx->resume.path);
+		if (ctx->resume.depth < 0) {
+			ctx->resume.depth = 0;
+			return 0;
+		}
+		fill_stats(ctx, stats);
+	}
+	if (ctx->profile) {
+		report_profile(ctx);
+	}
+	return 1;
+}
+
+void nonogram_destroy(nonogram_t *ctx) {
+	free_data(ctx);
+	free(ctx);
+}
+
+static void init_data(nonogram_t *ctx) {
+	ctx->colors_size = 0;
+	ctx->colors = NULL;
+	ctx->text_size = 0;
+	ctx->text = NULL;
+	ctx->grid = NULL;
+	ctx->clues_size = 0;
+	ctx->clues = NULL;
+	ctx->cells_size = 0;
+	ctx->cells = NULL;
+	ctx->sets_size = 0;
+	ctx->sorted_sets = NULL;
+	ctx->locked_sets = NULL;
+	ctx->frames = NULL;
+	ctx->queued_clues = NULL;
+	ctx->table_size = 0;
+	ctx->table = NULL;
+	ctx->table_words_n = 0;
+	ctx->table_clues = NULL;
+	ctx->probe_clues = NULL;
+	ctx->table_seed = 0;
+	ctx->locked_clues = NULL;
+	ctx->locked_cells = NULL;
+	ctx->arena_size = 0;
+	ctx->arena = NULL;
+	ctx->trail_size = 0;
+	ctx->trail = NULL;
+	ctx->saved_clues_size = 0;
+	ctx->saved_clues = NULL;
+	ctx->nogoods_size = 0;
+	ctx->nogoods_n = 0;
+	ctx->nogoods = NULL;
+	ctx->buckets_n = 0;
+	ctx->buckets = NULL;
+	ctx->placements_size = 0;
+	ctx->placements = NULL;
+	ctx->checker = NULL;
+}
+
+/* Reads the lines of one puzzle (the grid attributes and the two lines of
+clues) into the text buffer, so that the input is left at the start of the
+next puzzle. The end of the input is left to the parser to report. */
+static int read_text(nonogram_t *ctx, size_t *size) {
+	int numbers_n = 0, lines_n = 0;
+	*size = 0;
+	while (lines_n < 2) {
+		size_t start = *size, i;
+		do {
+			if (ctx->text_size-*size < 2) {
+				size_t text_size = ctx->text_size ? ctx->text_size*2:TEXT_SIZE_MIN;
+				char *text = realloc(ctx->text, text_size);
+				if (!text) {
+					fputs("Could not reallocate memory for text\n", stderr);
+					fflush(stderr);
+					return 0;
+				}
+				ctx->text = text;
+				ctx->text_size = text_size;
+			}
+			if (!fgets(ctx->text+*size, (int)(ctx->text_size-*size < INT_MAX ? ctx->text_size-*size:INT_MAX), ctx->input)) {
+				return 1;
+			}
+			*size += strlen(ctx->text+*size);
+		}
+		while (ctx->text[*size-1] != SEPARATOR_LINES);
+		if (numbers_n < 2) {
+			for (i = start; i < *size && numbers_n < 2; ++i) {
+				if (isdigit((unsigned char)ctx->text[i]) && (i == start || !isdigit((unsigned char)ctx->text[i-1]))) {
+					++numbers_n;
+				}
+			}
+		}
+		else {
+			++lines_n;
+		}
+	}
+	return 1;
+}
+
+static int parse_puzzle(nonogram_t *ctx, parser_t *parser) {
+	int c, i;
+	if (!parse_int(parser, &ctx->width) || !parse_int(parser, &ctx->height) || ctx->width < 1 || ctx->height < 1) {
+		return parse_error(parser, "Invalid grid attributes");
+	}
+	do {
+		c = next_char(parser);
+	}
+	while (c == ' ' || c == '\t' || c == '\r');
+	if (c != SEPARATOR_LINES) {
+		return parse_error(parser, "End of line expected after grid attributes");
+	}
+	if (!reserve_colors(ctx)) {
+		return 0;
+	}
+	ctx->clues_n = ctx->width+ctx->height;
+	if (!reserve_clues(ctx)) {
+		return 0;
+	}
+	for (i = 0; i < ctx->width-1; ++i) {
+		if (!parse_clue(ctx, parser, ctx->clues+i, i, SEPARATOR_CLUES)) {
+			return 0;
+		}
+	}
+	if (!parse_clue(ctx, parser, ctx->clues+i, i, SEPARATOR_LINES)) {
+		return 0;
+	}
+	for (++i; i < ctx->clues_n-1; ++i) {
+		if (!parse_clue(ctx, parser, ctx->clues+i, i, SEPARATOR_CLUES)) {
+			return 0;
+		}
+	}
+	if (!parse_clue(ctx, parser, ctx->clues+i, i, SEPARATOR_LINES)) {
+		return 0;
+	}
+	return build_puzzle(ctx);
+}
+
+/* The record holds the dimensions, the symbols of the colors and the sets of
+each clue as variable length integers, the color index of a set is omitted
+when there is only one color. */
+static int decode_puzzle(nonogram_t *ctx, const unsigned char *data, size_t size) {
+	int colors_n, i;
+	size_t pos = 0;
+	if (!decode_int(data, size, &pos, &ctx->width) || !decode_int(data, size, &pos, &ctx->height) || !decode_int(data, size, &pos, &colors_n) || ctx->width < 1 || ctx->height < 1 || colors_n < 1 || colors_n > COLORS_MAX-COLOR_POS_BLACK) {
+		return 0;
+	}
+	if (!reserve_colors(ctx)) {
+		return 0;
+	}
+
+	/* The symbols are checked like in the text, black or alphanumeric and
+	each color once. */
+	for (i = 0; i < colors_n; ++i) {
+		int color, color_pos;
+		if (!decode_int(data, size, &pos, &color) || (color != COLOR_BLACK && (color > UCHAR_MAX || !isalnum(color)))) {
+			return 0;
+		}
+		for (color_pos = COLOR_POS_BLACK; color_pos < ctx->colors_n && ctx->colors[color_pos] != color; ++color_pos);
+		if (color_pos < ctx->colors_n) {
+			return 0;
+		}
+		ctx->colors[ctx->colors_n++] = color;
+	}
+	ctx->clues_n = ctx->width+ctx->height;
+	if (!reserve_clues(ctx)) {
+		return 0;
+	}
+	for (i = 0; i < ctx->clues_n; ++i) {
+		int sets_n, j;
+		clue_t *clue = ctx->clues+i;
+		if (!decode_int(data, size, &pos, &sets_n) || !reserve_clue_sets(clue, sets_n)) {
+			return 0;
+		}
+		clue->pos = i;
+		for (j = 0; j < sets_n; ++j) {
+			int len, color = 0;
+			if (!decode_int(data, size, &pos, &len) || len < 1 || (colors_n > 1 && !decode_int(data, size, &pos, &color)) || color >= colors_n) {
+				return 0;
+			}
+			init_set_fields(clue->sets+j, len, COLOR_POS_BLACK+color, clue);
+		}
+		clue->sets_n = sets_n;
+		clue->sets_header = clue->sets+clue->sets_n;
+		init_set_fields(clue->sets_header, 0, COLOR_POS_UNKNOWN, clue);
+	}
+	return pos == size && build_puzzle(ctx);
+}
+
+/* Copies the clues of a loaded puzzle, the source is only read so it may be
+searched at the same time. */
+static int copy_puzzle(nonogram_t *ctx, const nonogram_t *src) {
+	int i;
+	ctx->width = src->width;
+	ctx->height = src->height;
+	ctx->colors_n = src->colors_n;
+	ctx->colors = alloc_mem("colors", sizeof(int), ctx->colors_n);
+	if (!ctx->colors) {
+		return 0;
+	}
+	ctx->colors_size = ctx->colors_n;
+	memcpy(ctx->colors, src->colors, sizeof(int)*(size_t)ctx->colors_n);
+	ctx->clues_n = src->clues_n;
+	if (!reserve_clues(ctx)) {
+		return 0;
+	}
+	for (i = 0; i < ctx->clues_n; ++i) {
+		int j;
+		clue_t *clue = ctx->clues+i;
+		clue->pos = i;
+		clue->sets_n = src->clues[i].sets_n;
+		clue->sets = alloc_mem("clue->sets", sizeof(set_t), clue->sets_n+1);
+		if (!clue->sets) {
+			return 0;
+		}
+		clue->sets_size = clue->sets_n+1;
+		for (j = 0; j < clue->sets_n; ++j) {
+			init_set_fields(clue->sets+j, src->clues[i].sets[j].len, src->clues[i].sets[j].color_pos, clue);
+		}
+		clue->sets_header = clue->sets+clue->sets_n;
+		init_set_fields(clue->sets_header, 0, COLOR_POS_UNKNOWN, clue);
+	}
+	return build_puzzle(ctx);
+}
+
+static int build_puzzle(nonogram_t *ctx) {
+	int i;
+	uint64_t *swept_clues;
+	for (i = 0; i < ctx->clues_n; ++i) {
+		if (!init_clue(ctx, ctx->clues+i)) {
+			return 0;
+		}
+	}
+	ctx->grid_size = ctx->width*ctx->height;
+	ctx->sets_n = ctx->clues[0].sets_n;
+	for (i = 1; i < ctx->clues_n; ++i) {
+		ctx->sets_n += ctx->clues[i].sets_n;
+	}
+	if (!reserve_arena(ctx)) {
+		return 0;
+	}
+	ctx->line_bits = ctx->line_bits_n ? arena_alloc(ctx, sizeof(bits_t), ctx->line_bits_n):NULL;
+	swept_clues = arena_alloc(ctx, sizeof(uint64_t), ctx->sets_n*ctx->clue_words_n);
+	for (i = 0; i < ctx->clues_n; ++i) {
+		int j;
+		if (!init_clue_tables(ctx, ctx->clues+i)) {
+			return 0;
+		}
+		for (j = 0; j < ctx->clues[i].sets_n; ++j) {
+			ctx->clues[i].sets[j].swept_clues = swept_clues;
+			swept_clues += ctx->clue_words_n;
+		}
+	}
+	ctx->clues_header = ctx->clues+ctx->clues_n;
+	ctx->clues_header->pos = ctx->clues_n;
+	link_clue(ctx->clues, ctx->clues_header, ctx->clues+1);
+	for (i = 1; i < ctx->clues_n; ++i) {
+		link_clue(ctx->clues+i, ctx->clues+i-1, ctx->clues+i+1);
+	}
+	link_clue(ctx->clues_header, ctx->clues_header-1, ctx->clues);
+	if (!reserve_cells(ctx)) {
+		return 0;
+	}
+	for (i = 0; i < ctx->height; ++i) {
+		int j;
+		for (j = 0; j < ctx->width; ++j) {
+			init_cell(ctx, ctx->cells+i*ctx->width+j, ctx->clues+j, ctx->clues+ctx->width+i);
+		}
+	}
+	for (i = ctx->width; i--; ) {
+		link_column_clue(ctx, ctx->clues+i, ctx->cells+i);
+	}
+	for (i = ctx->height; i--; ) {
+		link_row_clue(ctx, ctx->clues+ctx->width+i, ctx->cells+i*ctx->width);
+	}
+	if (!reserve_sets(ctx)) {
+		return 0;
+	}
+	return 1;
+}
+
+/* The colors array is allocated once at its maximum size. */
+static int reserve_colors(nonogram_t *ctx) {
+	if (ctx->colors_size < COLORS_MAX) {
+		free(ctx->colors);
+		ctx->colors_size = 0;
+		ctx->colors = alloc_mem("colors", sizeof(int), COLORS_MAX);
+		if (!ctx->colors) {
+			return 0;
+		}
+		ctx->colors_size = COLORS_MAX;
+	}
+	ctx->colors[COLOR_POS_UNKNOWN] = COLOR_UNKNOWN;
+	ctx->colors[COLOR_POS_SEVERAL] = COLOR_SEVERAL;
+	ctx->colors[COLOR_POS_EMPTY] = COLOR_EMPTY;
+	ctx->colors_n = COLOR_POS_BLACK;
+	return 1;
+}
+
+static int reserve_clues(nonogram_t *ctx) {
+	int i;
+	clue_t *clues;
+	if (ctx->clues_n < ctx->clues_size) {
+		return 1;
+	}
+	free(ctx->locked_clues);
+	ctx->locked_clues = NULL;
+	free(ctx->queued_clues);
+	ctx->queued_clues = NULL;
+	clues = realloc_mem("clues", ctx->clues, sizeof(clue_t), ctx->clues_n+1);
+	if (!clues) {
+		return 0;
+	}
+	ctx->clues = clues;
+	for (i = ctx->clues_size; i <= ctx->clues_n; ++i) {
+		ctx->clues[i].sets_size = 0;
+		ctx->clues[i].sets = NULL;
+		ctx->clues[i].bounds_size = 0;
+		ctx->clues[i].bounds = NULL;
+	}
+	ctx->clues_size = ctx->clues_n+1;
+	ctx->queued_clues = alloc_mem("queued_clues", sizeof(clue_t *), ctx->clues_size);
+	if (!ctx->queued_clues) {
+		return 0;
+	}
+	ctx->locked_clues = alloc_mem("locked_clues", sizeof(clue_t *), ctx->clues_size);
+	if (!ctx->locked_clues) {
+		free(ctx->queued_clues);
+		ctx->queued_clues = NULL;
+		return 0;
+	}
+	return 1;
+}
+
+static int reserve_cells(nonogram_t *ctx) {
+	int cells_n = ctx->grid_size+ctx->clues_n;
+	if (cells_n <= ctx->cells_size) {
+		return 1;
+	}
+	free(ctx->grid);
+	ctx->grid = NULL;
+	free(ctx->locked_cells);
+	ctx->locked_cells = NULL;
+	free(ctx->cells);
+	ctx->cells = NULL;
+	ctx->cells_size = 0;
+	ctx->cells = alloc_mem("cells", sizeof(cell_t), cells_n);
+	if (!ctx->cells) {
+		return 0;
+	}
+	ctx->locked_cells = alloc_mem("locked_cells", sizeof(cell_t *), cells_n);
+	if (!ctx->locked_cells) {
+		free(ctx->cells);
+		ctx->cells = NULL;
+		return 0;
+	}
+	ctx->grid = alloc_mem("grid", sizeof(char), cells_n);
+	if (!ctx->grid) {
+		free(ctx->locked_cells);
+		ctx->locked_cells = NULL;
+		free(ctx->cells);
+		ctx->cells = NULL;
+		return 0;
+	}
+	ctx->cells_size = cells_n;
+	return 1;
+}
+
+/* The frames are indexed by depth, see alloc_worker_paths for their number. */
+static int reserve_sets(nonogram_t *ctx) {
+	if (ctx->sets_n <= ctx->sets_size) {
+		return 1;
+	}
+	free(ctx->frames);
+	ctx->frames = NULL;
+	free(ctx->locked_sets);
+	ctx->locked_sets = NULL;
+	free(ctx->sorted_sets);
+	ctx->sorted_sets = NULL;
+	ctx->sets_size = 0;
+	ctx->sorted_sets = alloc_mem("sorted_sets", sizeof(set_t *), ctx->sets_n);
+	if (!ctx->sorted_sets) {
+		return 0;
+	}
+	ctx->locked_sets = alloc_mem("locked_sets", sizeof(set_t *), ctx->sets_n);
+	if (!ctx->locked_sets) {
+		free(ctx->sorted_sets);
+		ctx->sorted_sets = NULL;
+		return 0;
+	}
+	ctx->frames = alloc_mem("frames", sizeof(frame_t), ctx->sets_n+1);
+	if (!ctx->frames) {
+		free(ctx->locked_sets);
+		ctx->locked_sets = NULL;
+		free(ctx->sorted_sets);
+		ctx->sorted_sets = NULL;
+		return 0;
+	}
+	ctx->sets_size = ctx->sets_n;
+	return 1;
+}
+
+/* The caches and options of all sets and the color caches of all cells are
+carved from a single block, laid out clue by clue. It starts with the work
+bitsets of the black and white line solver and the bitsets of the clues swept
+by the probes of each set. */
+static int reserve_arena(nonogram_t *ctx) {
+	int i;
+	size_t arena_size = 0;
+	ctx->line_bits_n = 0;
+	for (i = 0; i < ctx->clues_n; ++i) {
+		if (ctx->colors_n == COLOR_POS_BLACK+1 && (ctx->clues[i].pos < ctx->width ? ctx->height:ctx->width) <= LINE_BITS_MAX && ctx->clues[i].sets_n*4+2 > ctx->line_bits_n) {
+			ctx->line_bits_n = ctx->clues[i].sets_n*4+2;
+		}
+		arena_size += get_clue_tables_size(ctx->clues+i);
+	}
+	arena_size += sizeof(bits_t)*(size_t)ctx->line_bits_n;
+	ctx->clue_words_n = (ctx->clues_n+63)/64;
+	arena_size += sizeof(uint64_t)*(size_t)ctx->sets_n*(size_t)ctx->clue_words_n;
+	ctx->arena_used = 0;
+	if (arena_size <= ctx->arena_size) {
+		return 1;
+	}
+	free(ctx->arena);
+	ctx->arena_size = 0;
+	ctx->arena = malloc(arena_size);
+	if (!ctx->arena) {
+		fputs("Could not allocate memory for arena\n", stderr);
+		fflush(stderr);
+		return 0;
+	}
+	ctx->arena_size = arena_size;
+	return 1;
+}
+
+static void *arena_alloc(nonogram_t *ctx, size_t item_size, int items_n) {
+	void *mem = ctx->arena+ctx->arena_used;
+	ctx->arena_used += item_size*(size_t)items_n;
+	return mem;
+}
+
+static void init_search(nonogram_t *ctx) {
+	int i;
+	ctx->all_nodes_n = 0;
+	ctx->run_nodes_n = 0;
+	ctx->failures_n = 0;
+	ctx->memory_size = 0;
+	ctx->aborted = NONOGRAM_ABORT_NONE;
+	ctx->solutions_n = 0UL;
+	ctx->depth = 0;
+	ctx->max_depth = 0;
+	ctx->completed_depth = 0;
+	ctx->negative_cache = -1;
+	ctx->trail_n = 0;
+	ctx->saved_clues_n = 0;
+	ctx->queued_clues_n = 0;
+	ctx->locked_cells_n = 0U;
+	ctx->locked_clues_n = 0U;
+	ctx->locked_sets_n = 0U;
+	ctx->hash = 0;
+	ctx->probes_limit = ctx->sets_n;
+	ctx->probes_stamp = 0;
+	ctx->swept_clues = NULL;
+	ctx->restarts_n = 0;
+	ctx->restart_start = 0;
+	for (i = 0; i < ctx->clues_n; ++i) {
+		ctx->clues[i].failures = 0;
+	}
+	init_ties(ctx);
+	memset(&ctx->counters, 0, sizeof(counters_t));
+}
+
+/* The ties between sets or options with the same evaluation are broken in a
+random order that depends on the seed and the number of restarts, or in the
+order of the clues and positions without seed. */
+static void init_ties(nonogram_t *ctx) {
+	int i;
+	uint64_t seed = ctx->seed ? ctx->seed+(uint64_t)ctx->restarts_n:(uint64_t)ctx->restarts_n;
+	for (i = 0; i < ctx->clues_n; ++i) {
+		int j;
+		for (j = 0; j < ctx->clues[i].sets_n; ++j) {
+			ctx->clues[i].sets[j].tie = seed ? mix_hash(mix_hash(seed)^((uint64_t)i << 32 | (uint64_t)j)):0;
+		}
+	}
+}
+
+/* The search is restarted from the root when the number of run nodes since
+the last restart goes over the restart limit, until a solution is found so
+that the solutions are still enumerated by one complete search. The limit is
+the restart unit times the Luby sequence (1, 1, 2, 1, 1, 2, 4, ...), and the
+failures counted for each clue are kept to prefer the sets of the clues that
+failed most often. */
+static void run_search(nonogram_t *ctx) {
+	nonogram(ctx);
+	while (ctx->aborted == ABORT_RESTART) {
+		ctx->aborted = NONOGRAM_ABORT_NONE;
+		++ctx->restarts_n;
+		ctx->restart_start = ctx->run_nodes_n;
+		if (ctx->trace) {
+			fprintf(ctx->trace, "\nRestart %d\n", ctx->restarts_n);
+			fflush(ctx->trace);
+		}
+		init_ties(ctx);
+		nonogram(ctx);
+	}
+}
+
+/* Only checked at the run nodes like the pruning of the workers, a probe that
+fails because the search is stopped would rule out its option. */
+static int check_restart(nonogram_t *ctx) {
+	if (ctx->restart_nodes && !ctx->solutions_n && ctx->run_nodes_n-ctx->restart_start > ctx->restart_nodes*get_luby(ctx->restarts_n+1)) {
+		ctx->aborted = ABORT_RESTART;
+		return 1;
+	}
+	return 0;
+}
+
+static uint64_t get_luby(int i) {
+	int k;
+	for (k = 1; (1 << k)-1 < i; ++k);
+	while ((1 << k)-1 != i) {
+		i -= (1 << (k-1))-1;
+		for (k = 1; (1 << k)-1 < i; ++k);
+	}
+	return UINT64_C(1) << (k-1);
+}
+
+static void report_solution(nonogram_t *ctx) {
+	int i;
+	nonogram_stats_t stats;
+	if (!ctx->callback) {
+		return;
+	}
+	for (i = 0; i < ctx->grid_size; ++i) {
+		ctx->grid[i] = (char)ctx->colors[ctx->cells[i].color_pos];
+	}
+	fill_stats(ctx, &stats);
+	if (!ctx->callback(ctx->data, &stats, ctx->grid)) {
+		ctx->solutions_max = ctx->solutions_n;
+	}
+}
+
+/* Two solutions were proved by the probes in unique mode, the search stops
+like when the second one is found. */
+static void report_multiple(nonogram_t *ctx) {
+	ctx->solutions_n = ctx->solutions_max;
+	if (ctx->worker) {
+		pthread_mutex_lock(&ctx->pool->mutex);
+		ctx->pool->multiple = 1;
+		__atomic_add_fetch(&ctx->pool->version, 1, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&ctx->pool->mutex);
+	}
+}
+
+static void fill_stats(const nonogram_t *ctx, nonogram_stats_t *stats) {
+	stats->time = get_time(ctx);
+	stats->all_nodes_n = ctx->all_nodes_n;
+	stats->run_nodes_n = ctx->run_nodes_n;
+	stats->failures_n = ctx->failures_n;
+	stats->sweep_failures_n = ctx->counters.sweep_failures_n;
+	stats->depth = ctx->depth;
+	stats->max_depth = ctx->max_depth;
+	stats->completed_depth = ctx->completed_depth;
+	stats->cells_n = ctx->grid_size;
+	stats->locked_cells_n = ctx->locked_cells_n;
+	stats->solutions_n = ctx->solutions_n;
+	stats->aborted = ctx->aborted;
+	stats->table_hits_n = ctx->counters.table_hits_n;
+	stats->table_misses_n = ctx->counters.table_misses_n;
+	stats->winner = ctx->member ? ctx->member->index:0;
+	stats->strategy = ctx->strategy;
+	stats->seed = ctx->seed;
+	stats->restarts_n = ctx->restarts_n;
+	stats->nogoods_n = ctx->counters.nogoods_n;
+	stats->nogood_hits_n = ctx->counters.nogood_hits_n;
+}
+
+static uint64_t get_clock_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec*1000000000U+(uint64_t)now.tv_nsec;
+}
+
+/* Returns the number of seconds elapsed since the search started. */
+static double get_time(const nonogram_t *ctx) {
+	return (double)(get_clock_ns()-ctx->time_zero)/1e9;
+}
+
+/* The start time is taken only when profiling, a phase nested in another is
+included in both. */
+static void add_phase(nonogram_t *ctx, int phase, uint64_t start) {
+	++ctx->counters.phase_calls_n[phase];
+	ctx->counters.phase_ns[phase] += get_clock_ns()-start;
+}
+
+static void add_counters(counters_t *counters, const counters_t *other) {
+	int i;
+	for (i = 0; i < PHASES_N; ++i) {
+		counters->phase_calls_n[i] += other->phase_calls_n[i];
+		counters->phase_ns[i] += other->phase_ns[i];
+	}
+	counters->empty_cache_lookups_n += other->empty_cache_lookups_n;
+	counters->empty_cache_hits_n += other->empty_cache_hits_n;
+	counters->color_cache_lookups_n += other->color_cache_lookups_n;
+	counters->color_cache_hits_n += other->color_cache_hits_n;
+	counters->table_hits_n += other->table_hits_n;
+	counters->table_misses_n += other->table_misses_n;
+	counters->sweep_failures_n += other->sweep_failures_n;
+	counters->nogoods_n += other->nogoods_n;
+	counters->nogood_hits_n += other->nogood_hits_n;
+}
+
+static void report_profile(const nonogram_t *ctx) {
+	static const char *phase_names[PHASES_N] = { "Line sweeps", "Probes", "Set selections", "Backtracks", "Nogood learning" };
+	int i;
+	const counters_t *counters = &ctx->counters;
+	fputs("\nProfile\n", ctx->profile);
+	for (i = 0; i < PHASES_N; ++i) {
+		fprintf(ctx->profile, "%s %" PRIu64 " Time %.6fs\n", phase_names[i], counters->phase_calls_n[i], (double)counters->phase_ns[i]/1e9);
+	}
+	fprintf(ctx->profile, "Empty cache lookups %" PRIu64 " Hits %" PRIu64 " (%.1f%%)\n", counters->empty_cache_lookups_n, counters->empty_cache_hits_n, counters->empty_cache_lookups_n ? (double)counters->empty_cache_hits_n*100/(double)counters->empty_cache_lookups_n:0.0);
+	fprintf(ctx->profile, "Color cache lookups %" PRIu64 " Hits %" PRIu64 " (%.1f%%)\n", counters->color_cache_lookups_n, counters->color_cache_hits_n, counters->color_cache_lookups_n ? (double)counters->color_cache_hits_n*100/(double)counters->color_cache_lookups_n:0.0);
+	fprintf(ctx->profile, "Table lookups %" PRIu64 " Hits %" PRIu64 " (%.1f%%)\n", counters->table_hits_n+counters->table_misses_n, counters->table_hits_n, counters->table_hits_n+counters->table_misses_n ? (double)counters->table_hits_n*100/(double)(counters->table_hits_n+counters->table_misses_n):0.0);
+	fprintf(ctx->profile, "Failed sweeps of run nodes %" PRIu64 "\n", counters->sweep_failures_n);
+	fprintf(ctx->profile, "Nogoods learned %" PRIu64 " Hits %" PRIu64 "\n", counters->nogoods_n, counters->nogood_hits_n);
+	fflush(ctx->profile);
+}
+
+/* The arena and the tables that grow with the depth of the search. */
+static size_t get_memory_size(const nonogram_t *ctx) {
+	int i;
+	size_t memory_size = ctx->arena_size+sizeof(trail_t)*(size_t)ctx->trail_size+sizeof(saved_clue_t)*(size_t)ctx->saved_clues_size+(sizeof(table_entry_t)+sizeof(uint64_t)*(size_t)ctx->table_words_n)*ctx->table_size+sizeof(nogood_t)*(size_t)ctx->nogoods_size;
+	for (i = 0; i < ctx->clues_n; ++i) {
+		memory_size += sizeof(int)*(size_t)ctx->clues[i].bounds_size;
+	}
+	return memory_size;
+}
+
+static void add_memory(nonogram_t *ctx, size_t size) {
+	if (ctx->pool) {
+		__atomic_add_fetch(&ctx->pool->memory_size, size, __ATOMIC_RELAXED);
+	}
+	else {
+		ctx->memory_size += size;
+	}
+}
+
+/* Called at each node, the nodes and memory are counted in the pool when
+several workers are running. */
+static int check_budget(nonogram_t *ctx) {
+	if (ctx->member && __atomic_load_n(&ctx->member->portfolio->winner, __ATOMIC_ACQUIRE) >= 0) {
+		ctx->aborted = ABORT_PORTFOLIO;
+		return 1;
+	}
+	if (ctx->nodes_max < UINT64_MAX && (ctx->pool ? __atomic_add_fetch(&ctx->pool->all_nodes_n, 1, __ATOMIC_RELAXED):ctx->all_nodes_n) > ctx->nodes_max) {
+		abort_search(ctx, NONOGRAM_ABORT_NODES);
+		return 1;
+	}
+	if (ctx->time_max > 0.0 && get_time(ctx) > ctx->time_max) {
+		abort_search(ctx, NONOGRAM_ABORT_TIME);
+		return 1;
+	}
+	if (ctx->memory_max && (ctx->pool ? __atomic_load_n(&ctx->pool->memory_size, __ATOMIC_RELAXED):ctx->memory_size) > ctx->memory_max) {
+		abort_search(ctx, NONOGRAM_ABORT_MEMORY);
+		return 1;
+	}
+	return 0;
+}
+
+/* The grid of the node is kept as the partial result, only the first worker
+that goes over the budget writes it in the caller context. The others stop
+like when the pool is in error. */
+static void abort_search(nonogram_t *ctx, int aborted) {
+	int i;
+	char *grid = ctx->grid;
+	ctx->aborted = aborted;
+	if (ctx->pool) {
+		pthread_mutex_lock(&ctx->pool->mutex);
+		if (ctx->pool->aborted) {
+			pthread_mutex_unlock(&ctx->pool->mutex);
+			return;
+		}
+		ctx->pool->aborted = aborted;
+		grid = ctx->pool->workers->ctx->grid;
+	}
+	for (i = 0; i < ctx->grid_size; ++i) {
+		grid[i] = (char)ctx->colors[ctx->cells[i].color_pos];
+	}
+	if (ctx->pool) {
+		__atomic_add_fetch(&ctx->pool->version, 1, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&ctx->pool->mutex);
+	}
+}
+
+/* The number of entries is the largest power of 2 that fits in the size of
+the table with the clues swept by each probe, one more row of clues receives
+the current probe. The keys depend on the puzzle, a new seed is mixed in them
+for each search instead of clearing the table. */
+static int reserve_table(nonogram_t *ctx) {
+	size_t table_size = ctx->table_bytes/(sizeof(table_entry_t)+sizeof(uint64_t)*(size_t)ctx->clue_words_n);
+	while (table_size & (table_size-1)) {
+		table_size &= table_size-1;
+	}
+	if (table_size > TABLE_ENTRIES_MAX) {
+		table_size = TABLE_ENTRIES_MAX;
+	}
+	if (table_size != ctx->table_size || ctx->clue_words_n != ctx->table_words_n) {
+		free(ctx->table);
+		free(ctx->table_clues);
+		ctx->table = NULL;
+		ctx->table_clues = NULL;
+		ctx->probe_clues = NULL;
+		ctx->table_size = 0;
+		ctx->table_words_n = 0;
+		if (table_size) {
+			ctx->table = calloc(table_size, sizeof(table_entry_t));
+			ctx->table_clues = malloc(sizeof(uint64_t)*(size_t)ctx->clue_words_n*(table_size+1));
+			if (!ctx->table || !ctx->table_clues) {
+				fputs("Could not allocate memory for table\n", stderr);
+				fflush(stderr);
+				free(ctx->table);
+				free(ctx->table_clues);
+				ctx->table = NULL;
+				ctx->table_clues = NULL;
+				return 0;
+			}
+			ctx->table_size = table_size;
+			ctx->table_words_n = ctx->clue_words_n;
+			ctx->probe_clues = ctx->table_clues+(size_t)ctx->clue_words_n*table_size;
+		}
+	}
+	ctx->table_seed = mix_hash(ctx->table_seed+1);
+	return 1;
+}
+
+/* The store is emptied for each search, its table has at least 4 buckets per
+nogood. The checker is a new copy of the puzzle that is swept at the root, the
+nogoods are checked on it. */
+static int reserve_nogoods(nonogram_t *ctx) {
+	int i;
+	if (ctx->checker) {
+		nonogram_destroy(ctx->checker);
+		ctx->checker = NULL;
+	}
+	ctx->nogoods_n = 0;
+	ctx->nogoods_stamp = 0;
+	if (!ctx->nogoods_max) {
+		return 1;
+	}
+	if (ctx->nogoods_max != ctx->nogoods_size) {
+		free(ctx->nogoods);
+		free(ctx->buckets);
+		ctx->buckets = NULL;
+		ctx->buckets_n = 0;
+		ctx->nogoods_size = 0;
+		ctx->nogoods = alloc_mem("nogoods", sizeof(nogood_t), ctx->nogoods_max);
+		if (!ctx->nogoods) {
+			return 0;
+		}
+		ctx->nogoods_size = ctx->nogoods_max;
+
+		/* At least 4 buckets per nogood, the bound is divided instead of
+		multiplying the number of nogoods so that it cannot overflow. */
+		for (i = 1; i/4 < ctx->nogoods_max && i <= INT_MAX/2; i *= 2);
+		ctx->buckets = alloc_mem("buckets", sizeof(int), i);
+		if (!ctx->buckets) {
+			return 0;
+		}
+		ctx->buckets_n = i;
+	}
+	for (i = 0; i < ctx->buckets_n; ++i) {
+		ctx->buckets[i] = -1;
+	}
+	if (ctx->sets_n > ctx->placements_size) {
+		free(ctx->placements);
+		ctx->placements_size = 0;
+		ctx->placements = alloc_mem("placements", sizeof(placement_t), ctx->sets_n);
+		if (!ctx->placements) {
+			return 0;
+		}
+		ctx->placements_size = ctx->sets_n;
+	}
+	return init_checker(ctx);
+}
+
+/* The checker has no budget, the learning is given up when its root fails
+like the search. */
+static int init_checker(nonogram_t *ctx) {
+	option_t option;
+	nonogram_t *checker = nonogram_create();
+	if (!checker) {
+		return 0;
+	}
+	if (!copy_puzzle(checker, ctx)) {
+		nonogram_destroy(checker);
+		return 0;
+	}
+	checker->loaded = 1;
+	checker->solutions_max = ULONG_MAX;
+	checker->nodes_max = UINT64_MAX;
+	checker->time_max = 0.0;
+	checker->memory_max = 0;
+	checker->strategy = NONOGRAM_STRATEGY_PROBE;
+	checker->probes_budget = 0;
+	checker->time_zero = ctx->time_zero;
+	checker->trace = NULL;
+	checker->profile = NULL;
+	checker->callback = NULL;
+	checker->placements = alloc_mem("checker->placements", sizeof(placement_t), checker->sets_n);
+	if (!checker->placements) {
+		nonogram_destroy(checker);
+		return 0;
+	}
+	init_search(checker);
+	if (sweep_node(checker, NULL, &option, checker->frames) > 0) {
+		ctx->checker = checker;
+	}
+	else {
+		nonogram_destroy(checker);
+	}
+	return 1;
+}
+
+/* The failed node gives the placements of the sets branched on above it, that
+are replayed from the root by the checker. The node fails in the checker when a
+sweep fails, or when all the options of the set that had none left fail their
+probes. The placements kept in the nogood are moved to the start of the array.
+The shortest failing prefix of the placements left after them is found by
+bisection, its last placement is kept and the ones after it are dropped. The
+nogood is given up when it needs more than NOGOOD_SIZE_MAX placements or more
+than NOGOOD_CHECKS_MAX replays, each replay costs up to a sweep and the probes
+of the failed set. */
+static void learn_nogood(nonogram_t *ctx, const set_t *set_failed) {
+	int placements_n, kept_n = 0, checks_n = 1, i;
+	uint64_t phase_start;
+	placement_t *placements = ctx->placements;
+	nonogram_t *checker = ctx->checker;
+	if (!checker || !ctx->depth) {
+		return;
+	}
+	phase_start = ctx->profile ? get_clock_ns():0;
+	for (i = 0; i < ctx->depth; ++i) {
+		const frame_t *frame = ctx->frames+i;
+		init_placement(placements+i, frame->set_min, frame->set_min->options[frame->set_min->options_n-1-frame->rank].pos);
+	}
+	placements_n = check_placements(checker, placements, ctx->depth, set_failed);
+	if (placements_n <= ctx->depth) {
+		while (kept_n <= NOGOOD_SIZE_MAX) {
+			int lo = 0, hi = placements_n-kept_n;
+			while (lo < hi && checks_n < NOGOOD_CHECKS_MAX) {
+				int mid = (lo+hi)/2, failed_n = check_placements(checker, placements, kept_n+mid, set_failed);
+				if (failed_n <= kept_n+mid) {
+					hi = failed_n-kept_n;
+				}
+				else {
+					lo = mid+1;
+				}
+				++checks_n;
+			}
+			if (lo < hi) {
+				kept_n = NOGOOD_SIZE_MAX+1;
+				break;
+			}
+			if (lo <= 0) {
+				break;
+			}
+			if (kept_n < NOGOOD_SIZE_MAX) {
+				placement_t placement = placements[kept_n+lo-1];
+				memmove(placements+kept_n+1, placements+kept_n, sizeof(placement_t)*(size_t)(lo-1));
+				placements[kept_n] = placement;
+			}
+			++kept_n;
+			placements_n = kept_n+lo-1;
+		}
+		if (kept_n <= NOGOOD_SIZE_MAX) {
+			store_nogood(ctx, placements, kept_n);
+		}
+	}
+	if (ctx->profile) {
+		add_phase(ctx, PHASE_LEARN, phase_start);
+	}
+}
+
+/* The checker keeps the placements on its frames between the checks, only
+the ones after the common start are replayed. Returns the number of the first
+placements shown to fail, placements_n+1 if they do not fail. */
+static int check_placements(nonogram_t *checker, const placement_t *placements, int placements_n, const set_t *set_failed) {
+	int i;
+	for (i = 0; i < checker->depth && i < placements_n && !memcmp(checker->placements+i, placements+i, sizeof(placement_t)); ++i);
+	while (checker->depth > i) {
+		pop_placement(checker);
+	}
+	while (checker->depth < placements_n) {
+		if (!push_placement(checker, placements+checker->depth)) {
+			return checker->depth+1;
+		}
+	}
+	return set_failed && check_set_failed(checker, set_failed) ? placements_n:placements_n+1;
+}
+
+/* Branches on the placement like the search, the other positions of its set
+are marked as failed at the current depth. Nothing is swept when the set is
+already fixed, its clue may be locked. Returns 0 without going down if the
+placement or the sweep fails. */
+static int push_placement(nonogram_t *checker, const placement_t *placement) {
+	int i;
+	option_t option;
+	set_t *set = get_placement_set(checker, placement);
+	frame_t *frame = checker->frames+checker->depth;
+	if (placement->pos < set->color_bounds_min[DEPTH_CUR] || placement->pos > set->color_bounds_max[DEPTH_CUR] || set->color_cache[placement->pos-set->color_bounds_min[DEPTH_BCK]] < CACHE_UNKNOWN) {
+		return 0;
+	}
+	set->options_n = 0;
+	for (i = set->color_bounds_min[DEPTH_CUR]; i <= set->color_bounds_max[DEPTH_CUR]; ++i) {
+		if (i != placement->pos && set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
+			set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] = checker->negative_cache;
+			set->options[set->options_n++].pos = i;
+		}
+	}
+	frame->set_min = set;
+	checker->placements[checker->depth] = *placement;
+	++checker->depth;
+	--checker->negative_cache;
+	if (!set->options_n) {
+		init_frame(checker, frame+1);
+	}
+	else if (sweep_node(checker, set->clue, &option, frame+1) <= 0) {
+		pop_placement(checker);
+		return 0;
+	}
+	return 1;
+}
+
+static void pop_placement(nonogram_t *checker) {
+	int i;
+	frame_t *frame = checker->frames+checker->depth;
+	leave_node(checker, frame);
+	++checker->negative_cache;
+	--checker->depth;
+	--frame;
+	for (i = frame->set_min->options_n; i--; ) {
+		frame->set_min->color_cache[frame->set_min->options[i].pos-frame->set_min->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+	}
+	frame->set_min = NULL;
+}
+
+/* The probes mark the options that fail at the current depth, the marks are
+cleared after. A fixed set is not probed. */
+static int check_set_failed(nonogram_t *checker, const set_t *set_failed) {
+	int i;
+	placement_t placement;
+	set_t *set;
+	init_placement(&placement, set_failed, 0);
+	set = get_placement_set(checker, &placement);
+	if (set->color_bounds_min[DEPTH_CUR] == set->color_bounds_max[DEPTH_CUR]) {
+		return 0;
+	}
+	set->options_n = 0;
+	for (i = set->color_bounds_min[DEPTH_CUR]; i <= set->color_bounds_max[DEPTH_CUR]; ++i) {
+		if (set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
+			set->options[set->options_n++].pos = i;
+		}
+	}
+	if (!set->options_n) {
+		return 1;
+	}
+	evaluate_set(checker, set);
+	for (i = set->color_bounds_min[DEPTH_CUR]; i <= set->color_bounds_max[DEPTH_CUR]; ++i) {
+		if (set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] == checker->negative_cache) {
+			set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+		}
+	}
+	return !set->options_n;
+}
+
+/* The least recently used nogood is replaced when the store is full. */
+static void store_nogood(nonogram_t *ctx, const placement_t *placements, int placements_n) {
+	int i;
+	nogood_t *nogood;
+	if (ctx->nogoods_n < ctx->nogoods_size) {
+		nogood = ctx->nogoods+ctx->nogoods_n++;
+	}
+	else {
+		nogood = ctx->nogoods;
+		for (i = 1; i < ctx->nogoods_n; ++i) {
+			if (ctx->nogoods[i].activity < nogood->activity) {
+				nogood = ctx->nogoods+i;
+			}
+		}
+		for (i = 0; i < nogood->placements_n; ++i) {
+			unlink_placement(ctx, (int)(nogood-ctx->nogoods)*NOGOOD_SIZE_MAX+i);
+		}
+	}
+	nogood->placements_n = placements_n;
+	for (i = 0; i < placements_n; ++i) {
+		int bucket = get_bucket(ctx, placements+i);
+		nogood->placements[i] = placements[i];
+		nogood->next[i] = ctx->buckets[bucket];
+		nogood->last[i] = -1;
+		if (ctx->buckets[bucket] >= 0) {
+			ctx->nogoods[ctx->buckets[bucket]/NOGOOD_SIZE_MAX].last[ctx->buckets[bucket]%NOGOOD_SIZE_MAX] = (int)(nogood-ctx->nogoods)*NOGOOD_SIZE_MAX+i;
+		}
+		ctx->buckets[bucket] = (int)(nogood-ctx->nogoods)*NOGOOD_SIZE_MAX+i;
+	}
+	nogood->activity = ++ctx->nogoods_stamp;
+	++ctx->counters.nogoods_n;
+}
+
+static void unlink_placement(nonogram_t *ctx, int link) {
+	nogood_t *nogood = ctx->nogoods+link/NOGOOD_SIZE_MAX;
+	int i = link%NOGOOD_SIZE_MAX;
+	if (nogood->last[i] >= 0) {
+		ctx->nogoods[nogood->last[i]/NOGOOD_SIZE_MAX].next[nogood->last[i]%NOGOOD_SIZE_MAX] = nogood->next[i];
+	}
+	else {
+		ctx->buckets[get_bucket(ctx, nogood->placements+i)] = nogood->next[i];
+	}
+	if (nogood->next[i] >= 0) {
+		ctx->nogoods[nogood->next[i]/NOGOOD_SIZE_MAX].last[nogood->next[i]%NOGOOD_SIZE_MAX] = nogood->last[i];
+	}
+}
+
+/* Returns 1 if the option completes a nogood, all its other placements are
+the only position left to their set at the node. */
+static int check_nogoods(nonogram_t *ctx, const set_t *set, int pos) {
+	int link;
+	placement_t placement;
+	init_placement(&placement, set, pos);
+	for (link = ctx->buckets[get_bucket(ctx, &placement)]; link >= 0; link = ctx->nogoods[link/NOGOOD_SIZE_MAX].next[link%NOGOOD_SIZE_MAX]) {
+		int i;
+		nogood_t *nogood = ctx->nogoods+link/NOGOOD_SIZE_MAX;
+		if (memcmp(nogood->placements+link%NOGOOD_SIZE_MAX, &placement, sizeof(placement_t))) {
+			continue;
+		}
+		for (i = 0; i < nogood->placements_n; ++i) {
+			if (i != link%NOGOOD_SIZE_MAX) {
+				const set_t *other = get_placement_set(ctx, nogood->placements+i);
+				if (other->color_bounds_min[DEPTH_CUR] != nogood->placements[i].pos || other->color_bounds_max[DEPTH_CUR] != nogood->placements[i].pos) {
+					break;
+				}
+			}
+		}
+		if (i == nogood->placements_n) {
+			nogood->activity = ++ctx->nogoods_stamp;
+			++ctx->counters.nogood_hits_n;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void init_placement(placement_t *placement, const set_t *set, int pos) {
+	placement->clue = set->clue->pos;
+	placement->set = (int)(set-set->clue->sets);
+	placement->pos = pos;
+}
+
+static set_t *get_placement_set(const nonogram_t *ctx, const placement_t *placement) {
+	return ctx->clues[placement->clue].sets+placement->set;
+}
+
+static int get_bucket(const nonogram_t *ctx, const placement_t *placement) {
+	return (int)(mix_hash((uint64_t)placement->clue << 40 ^ (uint64_t)placement->set << 20 ^ (uint64_t)placement->pos) & (uint64_t)(ctx->buckets_n-1));
+}
+
+/* Identifies the puzzle of a checkpoint from its size, colors and clues. */
+static uint64_t hash_puzzle(const nonogram_t *ctx) {
+	int i;
+	uint64_t hash = hash_int(hash_int(FNV_OFFSET, ctx->width), ctx->height);
+	for (i = COLOR_POS_EMPTY; i < ctx->colors_n; ++i) {
+		hash = hash_int(hash, ctx->colors[i]);
+	}
+	for (i = 0; i < ctx->clues_n; ++i) {
+		int j;
+		hash = hash_int(hash, ctx->clues[i].sets_n);
+		for (j = 0; j < ctx->clues[i].sets_n; ++j) {
+			hash = hash_int(hash_int(hash, ctx->clues[i].sets[j].len), ctx->clues[i].sets[j].color_pos);
+		}
+	}
+	return hash;
+}
+
+static uint64_t hash_int(uint64_t hash, int value) {
+	int i;
+	for (i = 0; i < 4; ++i) {
+		hash = (hash^(uint64_t)(((unsigned)value >> (i*8)) & 0xffU))*FNV_PRIME;
+	}
+	return hash;
+}
+
+/* Called before entering a run node, the file is written under a temporary
+name and renamed so that a stopped process leaves the previous checkpoint
+intact. A checkpoint that cannot be written does not stop the search. */
+static void write_checkpoint(nonogram_t *ctx) {
+	int i, r;
+	uint64_t header[CHECKPOINT_HEADER_N];
+	size_t name_len = strlen(ctx->checkpoint);
+	char *name = alloc_mem("checkpoint name", sizeof(char), (int)name_len+5);
+	FILE *output;
+	ctx->checkpoint_time = get_time(ctx)+ctx->checkpoint_period;
+	if (!name) {
+		return;
+	}
+	sprintf(name, "%s.tmp", ctx->checkpoint);
+	output = fopen(name, "wb");
+	if (!output) {
+		fprintf(stderr, "Could not open %s\n", name);
+		fflush(stderr);
+		free(name);
+		return;
+	}
+	header[0] = CHECKPOINT_MAGIC;
+	header[1] = hash_puzzle(ctx);
+	header[2] = get_clock_ns()-ctx->time_zero;
+	header[3] = ctx->all_nodes_n;
+	header[4] = ctx->run_nodes_n;
+	header[5] = ctx->failures_n;
+	header[6] = (uint64_t)ctx->solutions_n;
+	header[7] = (uint64_t)ctx->max_depth;
+	header[8] = (uint64_t)ctx->completed_depth;
+	header[9] = (uint64_t)ctx->depth;
+	header[10] = ctx->counters.table_hits_n;
+	header[11] = ctx->counters.table_misses_n;
+	header[12] = ctx->counters.sweep_failures_n;
+	get_settings(ctx, header+CHECKPOINT_SETTINGS);
+	r = fwrite(header, sizeof(uint64_t), CHECKPOINT_HEADER_N, output) == CHECKPOINT_HEADER_N;
+	for (i = 0; i < ctx->depth && r; ++i) {
+		r = fwrite(&ctx->frames[i].rank, sizeof(int), 1, output) == 1;
+	}
+	for (i = 0; i < ctx->depth && r; ++i) {
+		r = fwrite(&ctx->frames[i].probes_limit, sizeof(int), 1, output) == 1;
+	}
+	if (r) {
+		r = fwrite(&ctx->probes_limit, sizeof(int), 1, output) == 1;
+	}
+	if (fclose(output) || !r || rename(name, ctx->checkpoint)) {
+		fprintf(stderr, "Could not write checkpoint %s\n", ctx->checkpoint);
+		fflush(stderr);
+		remove(name);
+	}
+	free(name);
+}
+
+/* The nodes on the path are searched again, the statistics are then replaced
+by the saved ones in resume_search so that the search ends with the same
+counters as when it is not stopped. The solutions found before the
+checkpoint were already reported and are only counted. A checkpoint written
+under other settings would give another search tree, it is rejected. */
+static int read_checkpoint(nonogram_t *ctx, const char *name) {
+	int i, r;
+	uint64_t header[CHECKPOINT_HEADER_N], settings[CHECKPOINT_SETTINGS_N];
+	FILE *input = fopen(name, "rb");
+	if (!input) {
+		fprintf(stderr, "Could not open %s\n", name);
+		fflush(stderr);
+		return 0;
+	}
+	r = fread(header, sizeof(uint64_t), CHECKPOINT_HEADER_N, input) == CHECKPOINT_HEADER_N && header[0] == CHECKPOINT_MAGIC && header[1] == hash_puzzle(ctx) && header[9] <= (uint64_t)ctx->sets_n;
+	if (r) {
+		get_settings(ctx, settings);
+		if (memcmp(header+CHECKPOINT_SETTINGS, settings, sizeof(settings))) {
+			fclose(input);
+			fputs("Checkpoint does not match the search\n", stderr);
+			fflush(stderr);
+			return 0;
+		}
+		ctx->resume.path = alloc_mem("resume.path", sizeof(int), (int)header[9]*2+1);
+		r = ctx->resume.path != NULL;
+	}
+	for (i = 0; i <= (int)header[9]*2 && r; ++i) {
+		r = fread(ctx->resume.path+i, sizeof(int), 1, input) == 1 && ctx->resume.path[i] >= (i < (int)header[9] ? 0:1);
+	}
+	fclose(input);
+	if (!r) {
+		fprintf(stderr, "Invalid checkpoint %s\n", name);
+		fflush(stderr);
+		free_ints(&ctx->resume.path);
+		return 0;
+	}
+	ctx->resume.time_ns = header[2];
+	ctx->resume.all_nodes_n = header[3];
+	ctx->resume.run_nodes_n = header[4];
+	ctx->resume.failures_n = header[5];
+	ctx->resume.sweep_failures_n = header[12];
+	ctx->resume.solutions_n = header[6];
+	ctx->resume.table_hits_n = header[10];
+	ctx->resume.table_misses_n = header[11];
+	ctx->resume.max_depth = (int)header[7];
+	ctx->resume.completed_depth = (int)header[8];
+	ctx->resume.depth = (int)header[9];
+	ctx->resume.limits = ctx->resume.path+ctx->resume.depth;
+	return 1;
+}
+
+/* The settings that shape the search tree, saved in the checkpoints. */
+static void get_settings(const nonogram_t *ctx, uint64_t *settings) {
+	settings[0] = (uint64_t)ctx->strategy;
+	settings[1] = (uint64_t)ctx->probes_max;
+	settings[2] = (uint64_t)ctx->probes_budget;
+	settings[3] = ctx->seed;
+	settings[4] = ctx->restart_nodes;
+	settings[5] = (uint64_t)ctx->solutions_max;
+	settings[6] = (uint64_t)ctx->unique;
+}
+
+static void resume_search(nonogram_t *ctx) {
+	ctx->all_nodes_n = ctx->resume.all_nodes_n;
+	ctx->run_nodes_n = ctx->resume.run_nodes_n;
+	ctx->failures_n = ctx->resume.failures_n;
+	ctx->counters.sweep_failures_n = ctx->resume.sweep_failures_n;
+	ctx->solutions_n = (unsigned long)ctx->resume.solutions_n;
+	ctx->counters.table_hits_n = ctx->resume.table_hits_n;
+	ctx->counters.table_misses_n = ctx->resume.table_misses_n;
+	ctx->max_depth = ctx->resume.max_depth;
+	ctx->completed_depth = ctx->resume.completed_depth;
+	ctx->time_zero = get_clock_ns()-ctx->resume.time_ns;
+	ctx->checkpoint_time = get_time(ctx)+ctx->checkpoint_period;
+	ctx->probes_limit = ctx->resume.limits[ctx->resume.depth];
+	free_ints(&ctx->resume.path);
+	ctx->resume.limits = NULL;
+	ctx->resume.depth = 0;
+}
+
+/* The search settings of a context that runs beside the caller context. */
+static void copy_settings(nonogram_t *ctx, const nonogram_t *src) {
+	ctx->unique = src->unique;
+	ctx->solutions_max = src->solutions_max;
+	ctx->nodes_max = src->nodes_max;
+	ctx->time_max = src->time_max;
+	ctx->memory_max = src->memory_max;
+	ctx->table_bytes = src->table_bytes;
+	ctx->strategy = src->strategy;
+	ctx->probes_max = src->probes_max;
+	ctx->probes_budget = src->probes_budget;
+	ctx->seed = src->seed;
+	ctx->restart_nodes = src->restart_nodes;
+	ctx->nogoods_max = src->nogoods_max;
+	ctx->time_zero = src->time_zero;
+	ctx->trace = NULL;
+	ctx->profile = src->profile;
+	ctx->callback = NULL;
+}
+
+/* Parallel search: the calling thread runs worker 0 which starts with the
+whole tree, idle workers steal the upper half of the remaining options at the
+shallowest open frame of a busy worker and replay its path from the root.
+Solutions are keyed by their path (option rank at each depth) so they can be
+reported in the same order as the sequential search. */
+static int solve_workers(nonogram_t *ctx, int workers_n, nonogram_stats_t *stats) {
+	int i;
+	unsigned long j;
+	FILE *trace;
+	pool_t pool;
+	pool.workers = alloc_mem("pool.workers", sizeof(worker_t), workers_n);
+	if (!pool.workers) {
+		return 0;
+	}
+	pthread_mutex_init(&pool.mutex, NULL);
+	pthread_mutex_init(&pool.report_mutex, NULL);
+	for (i = 0; i < workers_n; ++i) {
+		pthread_mutex_init(&pool.workers[i].mutex, NULL);
+		pool.workers[i].pool = &pool;
+		pool.workers[i].ctx = i ? NULL:ctx;
+		pool.workers[i].busy = i == 0;
+		pool.workers[i].base_depth = 0;
+		pool.workers[i].ranged = 0;
+		pool.workers[i].rank_min = 0;
+		pool.workers[i].top = 0;
+		pool.workers[i].path = NULL;
+		pool.workers[i].ranks_end = NULL;
+		pool.workers[i].limits = NULL;
+		pool.workers[i].all_nodes_n = 0;
+		pool.workers[i].run_nodes_n = 0;
+		pool.workers[i].failures_n = 0;
+		pool.workers[i].max_depth = 0;
+		memset(&pool.workers[i].counters, 0, sizeof(counters_t));
+	}
+	pool.workers_n = workers_n;
+	pool.idle_n = workers_n-1;
+	pool.done = 0;
+	pool.error = 0;
+	pool.aborted = NONOGRAM_ABORT_NONE;
+	pool.multiple = 0;
+	pool.version = 0;
+	pool.all_nodes_n = 0;
+	pool.memory_size = 0;
+	pool.solutions_max = ctx->solutions_max;
+	pool.reported_n = 0UL;
+	pool.solutions_n = 0UL;
+	pool.solutions_size = 0UL;
+	pool.solutions = NULL;
+	pool.callback = ctx->callback;
+	pool.data = ctx->data;
+	trace = ctx->trace;
+	ctx->trace = NULL;
+	for (i = 1; i < workers_n; ++i) {
+		if (pthread_create(&pool.workers[i].thread, NULL, run_worker, pool.workers+i)) {
+			fputs("Could not create worker thread\n", stderr);
+			fflush(stderr);
+			break;
+		}
+	}
+	run_worker(pool.workers);
+	while (--i > 0) {
+		pthread_join(pool.workers[i].thread, NULL);
+	}
+	init_search(ctx);
+	ctx->aborted = pool.aborted;
+	for (i = 0; i < workers_n; ++i) {
+		ctx->all_nodes_n += pool.workers[i].all_nodes_n;
+		ctx->run_nodes_n += pool.workers[i].run_nodes_n;
+		ctx->failures_n += pool.workers[i].failures_n;
+		if (pool.workers[i].max_depth > ctx->max_depth) {
+			ctx->max_depth = pool.workers[i].max_depth;
+		}
+		add_counters(&ctx->counters, &pool.workers[i].counters);
+		pthread_mutex_destroy(&pool.workers[i].mutex);
+	}
+	report_solutions(ctx, &pool);
+	ctx->solutions_n = pool.multiple ? pool.solutions_max:pool.reported_n+pool.solutions_n;
+	fill_stats(ctx, stats);
+	for (j = 0UL; j < pool.solutions_n; ++j) {
+		free(pool.solutions[j].path);
+		free(pool.solutions[j].grid);
+	}
+	free(pool.solutions);
+	pthread_mutex_destroy(&pool.report_mutex);
+	pthread_mutex_destroy(&pool.mutex);
+	free(pool.workers);
+	ctx->trace = trace;
+	return !pool.error;
+}
+
+/* Worker 0 searches with the caller context, the others copy its puzzle. */
+static void *run_worker(void *arg) {
+	worker_t *worker = (worker_t *)arg;
+	nonogram_t *ctx = worker->ctx;
+	if (!ctx) {
+		ctx = nonogram_create();
+		if (!ctx) {
+			pthread_mutex_lock(&worker->pool->mutex);
+			worker->pool->error = 1;
+			pthread_mutex_unlock(&worker->pool->mutex);
+			return NULL;
+		}
+		ctx->loaded = copy_puzzle(ctx, worker->pool->workers->ctx);
+		copy_settings(ctx, worker->pool->workers->ctx);
+
+		/* Lowered by report_solutions when the callback stops the search,
+		which may already run in worker 0. */
+		pthread_mutex_lock(&worker->pool->mutex);
+		ctx->solutions_max = worker->pool->solutions_max;
+		pthread_mutex_unlock(&worker->pool->mutex);
+	}
+	ctx->pool = worker->pool;
+	ctx->worker = worker;
+	if (!ctx->loaded || !reserve_table(ctx) || !alloc_worker_paths(ctx)) {
+		abort_workers(ctx);
+	}
+	else {
+		init_search(ctx);
+		add_memory(ctx, get_memory_size(ctx));
+		while (worker->busy || steal_task(ctx)) {
+			nonogram(ctx);
+			leave_task(ctx);
+			report_solutions(ctx, worker->pool);
+		}
+		worker->all_nodes_n = ctx->all_nodes_n;
+		worker->run_nodes_n = ctx->run_nodes_n;
+		worker->failures_n = ctx->failures_n;
+		worker->max_depth = ctx->max_depth;
+		worker->counters = ctx->counters;
+		free_worker_paths(ctx);
+	}
+	ctx->pool = NULL;
+	ctx->worker = NULL;
+	if (!worker->ctx) {
+		nonogram_destroy(ctx);
+	}
+	return NULL;
+}
+
+/* A run node cannot be deeper than the number of sets as the set chosen for
+branching is locked at the next depth. */
+static int alloc_worker_paths(nonogram_t *ctx) {
+	ctx->threshold_path = alloc_mem("ctx->threshold_path", sizeof(int), ctx->sets_n+1);
+	if (!ctx->threshold_path) {
+		return 0;
+	}
+	ctx->threshold_version = 0;
+	ctx->threshold_depth = -1;
+	pthread_mutex_lock(&ctx->worker->mutex);
+	ctx->worker->path = alloc_mem("worker->path", sizeof(int), ctx->sets_n+1);
+	ctx->worker->ranks_end = alloc_mem("worker->ranks_end", sizeof(int), ctx->sets_n+1);
+	ctx->worker->limits = alloc_mem("worker->limits", sizeof(int), ctx->sets_n+1);
+	pthread_mutex_unlock(&ctx->worker->mutex);
+	if (!ctx->worker->path || !ctx->worker->ranks_end || !ctx->worker->limits) {
+		free_worker_paths(ctx);
+		return 0;
+	}
+	return 1;
+}
+
+static void free_worker_paths(nonogram_t *ctx) {
+	free_ints(&ctx->threshold_path);
+	pthread_mutex_lock(&ctx->worker->mutex);
+	free_ints(&ctx->worker->limits);
+	free_ints(&ctx->worker->ranks_end);
+	free_ints(&ctx->worker->path);
+	ctx->worker->top = 0;
+	pthread_mutex_unlock(&ctx->worker->mutex);
+}
+
+static void leave_task(nonogram_t *ctx) {
+	pool_t *pool = ctx->pool;
+	pthread_mutex_lock(&pool->mutex);
+	if (ctx->worker->busy) {
+		ctx->worker->busy = 0;
+		if (++pool->idle_n == pool->workers_n) {
+			pool->done = 1;
+		}
+	}
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+static int steal_task(nonogram_t *ctx) {
+	pool_t *pool = ctx->pool;
+	pthread_mutex_lock(&pool->mutex);
+	while (!pool->done) {
+		int i;
+		struct timespec wait = { 0, STEAL_WAIT_NS };
+		for (i = 1; i < pool->workers_n; ++i) {
+			worker_t *victim = pool->workers+(ctx->worker-pool->workers+i)%pool->workers_n;
+			if (victim->busy && steal_frame(ctx, victim)) {
+				ctx->worker->busy = 1;
+				--pool->idle_n;
+				pthread_mutex_unlock(&pool->mutex);
+				return 1;
+			}
+		}
+		pthread_mutex_unlock(&pool->mutex);
+		nanosleep(&wait, NULL);
+		pthread_mutex_lock(&pool->mutex);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	return 0;
+}
+
+static int steal_frame(nonogram_t *ctx, worker_t *victim) {
+	int i;
+	worker_t *worker = ctx->worker;
+	pthread_mutex_lock(&victim->mutex);
+	for (i = victim->base_depth; i < victim->top; ++i) {
+		int remaining = victim->ranks_end[i]-victim->path[i]-1;
+		if (remaining > 0) {
+			memcpy(worker->path, victim->path, sizeof(int)*(size_t)i);
+			memcpy(worker->limits, victim->limits, sizeof(int)*(size_t)(i+1));
+			worker->base_depth = i;
+			worker->ranged = 1;
+			worker->ranks_end[i] = victim->ranks_end[i];
+			victim->ranks_end[i] -= (remaining+1)/2;
+			worker->rank_min = victim->ranks_end[i];
+			worker->top = 0;
+			pthread_mutex_unlock(&victim->mutex);
+			return 1;
+		}
+	}
+	pthread_mutex_unlock(&victim->mutex);
+	return 0;
+}
+
+/* Returns the first option rank to search at the current depth: the replayed
+rank above the task depth, the stolen range at the task depth, all options
+below. The adaptive limit of the node is kept for the workers that steal it. */
+static int open_frame(nonogram_t *ctx, int options_n, int probes_limit) {
+	int rank_min;
+	worker_t *worker = ctx->worker;
+	pthread_mutex_lock(&worker->mutex);
+	worker->limits[ctx->depth] = probes_limit;
+	if (ctx->depth < worker->base_depth) {
+		rank_min = worker->path[ctx->depth];
+		worker->ranks_end[ctx->depth] = rank_min+1;
+	}
+	else if (ctx->depth == worker->base_depth && worker->ranged) {
+		rank_min = worker->rank_min;
+	}
+	else {
+		rank_min = 0;
+		worker->ranks_end[ctx->depth] = options_n;
+	}
+	pthread_mutex_unlock(&worker->mutex);
+	return rank_min;
+}
+
+static void enter_frame(nonogram_t *ctx, int rank) {
+	pthread_mutex_lock(&ctx->worker->mutex);
+	ctx->worker->path[ctx->depth] = rank;
+	ctx->worker->top = ctx->depth+1;
+	pthread_mutex_unlock(&ctx->worker->mutex);
+}
+
+static int get_rank_end(nonogram_t *ctx) {
+	int rank_end;
+	pthread_mutex_lock(&ctx->worker->mutex);
+	rank_end = ctx->worker->ranks_end[ctx->depth];
+	pthread_mutex_unlock(&ctx->worker->mutex);
+	return rank_end;
+}
+
+static void close_frame(nonogram_t *ctx) {
+	pthread_mutex_lock(&ctx->worker->mutex);
+	ctx->worker->top = ctx->depth;
+	pthread_mutex_unlock(&ctx->worker->mutex);
+}
+
+/* A subtree is pruned when the maximum number of solutions was already found
+before it in sequential order. */
+static int prune_worker(nonogram_t *ctx) {
+	int i;
+	pool_t *pool = ctx->pool;
+	if (__atomic_load_n(&pool->version, __ATOMIC_ACQUIRE) != ctx->threshold_version) {
+		pthread_mutex_lock(&pool->mutex);
+		ctx->threshold_version = pool->version;
+		if (pool->error || pool->aborted || pool->multiple || pool->reported_n == pool->solutions_max) {
+			ctx->threshold_depth = 0;
+		}
+		else if (pool->reported_n+pool->solutions_n == pool->solutions_max) {
+			ctx->threshold_depth = pool->solutions[pool->solutions_n-1].depth;
+			memcpy(ctx->threshold_path, pool->solutions[pool->solutions_n-1].path, sizeof(int)*(size_t)ctx->threshold_depth);
+		}
+		else {
+			ctx->threshold_depth = -1;
+		}
+		pthread_mutex_unlock(&pool->mutex);
+	}
+	if (ctx->threshold_depth < 0) {
+		return 0;
+	}
+	if (ctx->threshold_depth == 0) {
+		return 1;
+	}
+	for (i = 0; i < ctx->depth && i < ctx->threshold_depth; ++i) {
+		if (ctx->worker->path[i] != ctx->threshold_path[i]) {
+			return ctx->worker->path[i] > ctx->threshold_path[i];
+		}
+	}
+	return 0;
+}
+
+static void record_solution(nonogram_t *ctx) {
+	int i;
+	unsigned long lo, hi;
+	pool_t *pool = ctx->pool;
+	solution_t solution;
+	solution.depth = ctx->depth;
+	solution.path = alloc_mem("solution.path", sizeof(int), ctx->depth+1);
+	if (!solution.path) {
+		abort_workers(ctx);
+		return;
+	}
+	memcpy(solution.path, ctx->worker->path, sizeof(int)*(size_t)ctx->depth);
+	solution.grid = alloc_mem("solution.grid", sizeof(char), ctx->grid_size);
+	if (!solution.grid) {
+		free(solution.path);
+		abort_workers(ctx);
+		return;
+	}
+	for (i = 0; i < ctx->grid_size; ++i) {
+		solution.grid[i] = (char)ctx->colors[ctx->cells[i].color_pos];
+	}
+	pthread_mutex_lock(&pool->mutex);
+	lo = 0UL;
+	hi = pool->solutions_n;
+	while (lo < hi) {
+		unsigned long mid = lo+(hi-lo)/2;
+		if (compare_paths(pool->solutions[mid].depth, pool->solutions[mid].path, solution.depth, solution.path) < 0) {
+			lo = mid+1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	if (pool->reported_n+pool->solutions_n == pool->solutions_max) {
+		if (lo == pool->solutions_n) {
+			pthread_mutex_unlock(&pool->mutex);
+			free(solution.grid);
+			free(solution.path);
+			return;
+		}
+		--pool->solutions_n;
+		free(pool->solutions[pool->solutions_n].grid);
+		free(pool->solutions[pool->solutions_n].path);
+	}
+	else if (pool->solutions_n == pool->solutions_size) {
+		unsigned long solutions_size = pool->solutions_size ? pool->solutions_size*2:16UL;
+		solution_t *solutions = realloc(pool->solutions, sizeof(solution_t)*solutions_size);
+		if (!solutions) {
+			fputs("Could not reallocate memory for pool->solutions\n", stderr);
+			fflush(stderr);
+			pool->error = 1;
+			__atomic_add_fetch(&pool->version, 1, __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&pool->mutex);
+			free(solution.grid);
+			free(solution.path);
+			return;
+		}
+		pool->solutions = solutions;
+		pool->solutions_size = solutions_size;
+	}
+	memmove(pool->solutions+lo+1, pool->solutions+lo, sizeof(solution_t)*(pool->solutions_n-lo));
+	pool->solutions[lo] = solution;
+	++pool->solutions_n;
+	if (pool->reported_n+pool->solutions_n == pool->solutions_max) {
+		pool->multiple = ctx->unique;
+		__atomic_add_fetch(&pool->version, 1, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	report_solutions(ctx, pool);
+}
+
+/* The first solution kept is reported as soon as no busy worker can find one
+before it, so the solutions reach the callback one at a time in sequential
+order while the search goes on. Its statistics are the ones of the context
+that reports it. */
+static void report_solutions(nonogram_t *ctx, pool_t *pool) {
+	pthread_mutex_lock(&pool->report_mutex);
+	while (1) {
+		int r;
+		nonogram_stats_t stats;
+		solution_t solution;
+		pthread_mutex_lock(&pool->mutex);
+		if (!pool->callback || pool->error || !pool->solutions_n || !check_solution_first(pool, pool->solutions)) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		solution = pool->solutions[0];
+		--pool->solutions_n;
+		memmove(pool->solutions, pool->solutions+1, sizeof(solution_t)*pool->solutions_n);
+		fill_stats(ctx, &stats);
+		stats.solutions_n = ++pool->reported_n;
+		stats.depth = solution.depth;
+		stats.locked_cells_n = (unsigned)ctx->grid_size;
+		pthread_mutex_unlock(&pool->mutex);
+		r = pool->callback(pool->data, &stats, solution.grid);
+		free(solution.grid);
+		free(solution.path);
+
+		/* The solutions found after it are dropped like in the sequential
+		search. */
+		if (!r) {
+			pthread_mutex_lock(&pool->mutex);
+			while (pool->solutions_n) {
+				--pool->solutions_n;
+				free(pool->solutions[pool->solutions_n].grid);
+				free(pool->solutions[pool->solutions_n].path);
+			}
+			pool->solutions_max = pool->reported_n;
+			__atomic_add_fetch(&pool->version, 1, __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+	}
+	pthread_mutex_unlock(&pool->report_mutex);
+}
+
+/* A worker only goes forward from its current path, the path of a worker that
+did not replay its task yet is empty. */
+static int check_solution_first(const pool_t *pool, const solution_t *solution) {
+	int i, r = 1;
+	for (i = 0; i < pool->workers_n && r; ++i) {
+		worker_t *worker = pool->workers+i;
+		if (worker->busy) {
+			pthread_mutex_lock(&worker->mutex);
+			r = compare_paths(worker->top, worker->path, solution->depth, solution->path) >= 0;
+			pthread_mutex_unlock(&worker->mutex);
+		}
+	}
+	return r;
+}
+
+static int compare_paths(int depth_a, const int *path_a, int depth_b, const int *path_b) {
+	int i;
+	for (i = 0; i < depth_a && i < depth_b; ++i) {
+		if (path_a[i] != path_b[i]) {
+			return path_a[i]-path_b[i];
+		}
+	}
+	return depth_a-depth_b;
+}
+
+static void abort_workers(nonogram_t *ctx) {
+	pthread_mutex_lock(&ctx->pool->mutex);
+	ctx->pool->error = 1;
+	__atomic_add_fetch(&ctx->pool->version, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&ctx->pool->mutex);
+	leave_task(ctx);
+}
+
+/* Portfolio search: each member searches the whole tree on its own thread
+with a different strategy and tie break seed, the first member that completes
+its search stops the others. Member 0 searches with the caller context and
+settings, the solutions of each member are kept until the winner is known. The
+counters of the winner replace the ones of member 0 for the profile. */
+static int solve_portfolio(nonogram_t *ctx, int members_n, nonogram_stats_t *stats) {
+	int winner, error = 0, i;
+	unsigned long j;
+	FILE *trace;
+	nonogram_callback_t callback = ctx->callback;
+	void *data = ctx->data;
+	portfolio_t portfolio;
+	portfolio.members = alloc_mem("portfolio.members", sizeof(member_t), members_n);
+	if (!portfolio.members) {
+		return 0;
+	}
+	for (i = 0; i < members_n; ++i) {
+		portfolio.members[i].portfolio = &portfolio;
+		portfolio.members[i].ctx = i ? NULL:ctx;
+		portfolio.members[i].index = i;
+		portfolio.members[i].error = 0;
+		portfolio.members[i].solutions_n = 0UL;
+		portfolio.members[i].solutions_size = 0UL;
+		portfolio.members[i].solutions = NULL;
+	}
+	portfolio.members_n = members_n;
+	portfolio.winner = -1;
+	trace = ctx->trace;
+	ctx->trace = NULL;
+	for (i = 1; i < members_n; ++i) {
+		if (pthread_create(&portfolio.members[i].thread, NULL, run_member, portfolio.members+i)) {
+			fputs("Could not create member thread\n", stderr);
+			fflush(stderr);
+
+			/* The solve fails, the started members are stopped like when a
+			member completes. */
+			portfolio.members[i].error = 1;
+			__atomic_store_n(&portfolio.winner, i, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+	run_member(portfolio.members);
+	while (--i > 0) {
+		pthread_join(portfolio.members[i].thread, NULL);
+	}
+	for (i = 0; i < members_n; ++i) {
+		if (portfolio.members[i].error) {
+			error = 1;
+		}
+	}
+
+	/* Member 0 is reported when no member completed its search. */
+	winner = portfolio.winner < 0 ? 0:portfolio.winner;
+	if (!error) {
+		member_t *member = portfolio.members+winner;
+		unsigned long solutions_n = member->ctx->solutions_n;
+		member->ctx->locked_cells_n = (unsigned)member->ctx->grid_size;
+		for (j = 0UL; j < member->solutions_n && callback; ++j) {
+			nonogram_stats_t solution_stats;
+			member->ctx->solutions_n = j+1UL;
+			fill_stats(member->ctx, &solution_stats);
+			solution_stats.depth = member->solutions[j].depth;
+			if (!callback(data, &solution_stats, member->solutions[j].grid)) {
+				break;
+			}
+		}
+		member->ctx->locked_cells_n = 0U;
+		member->ctx->solutions_n = solutions_n;
+		fill_stats(member->ctx, stats);
+		if (winner) {
+			ctx->aborted = NONOGRAM_ABORT_NONE;
+			ctx->counters = member->ctx->counters;
+		}
+	}
+	for (i = 0; i < members_n; ++i) {
+		for (j = 0UL; j < portfolio.members[i].solutions_n; ++j) {
+			free(portfolio.members[i].solutions[j].grid);
+		}
+		free(portfolio.members[i].solutions);
+		if (i && portfolio.members[i].ctx) {
+			nonogram_destroy(portfolio.members[i].ctx);
+		}
+	}
+	free(portfolio.members);
+	ctx->member = NULL;
+	ctx->callback = callback;
+	ctx->data = data;
+	ctx->trace = trace;
+	return !error;
+}
+
+/* The other members copy the puzzle of member 0, their strategy goes through
+the ones that are not the strategy of member 0 first. */
+static void *run_member(void *arg) {
+	member_t *member = (member_t *)arg;
+	nonogram_t *ctx = member->ctx;
+	if (!ctx) {
+		static const int strategies[] = { NONOGRAM_STRATEGY_PROBE, NONOGRAM_STRATEGY_ADAPTIVE, NONOGRAM_STRATEGY_TOP, NONOGRAM_STRATEGY_FEWEST };
+		const nonogram_t *src = member->portfolio->members->ctx;
+		int strategies_n = (int)(sizeof(strategies)/sizeof(int)), i;
+		ctx = nonogram_create();
+		if (!ctx) {
+			member->error = 1;
+			return NULL;
+		}
+		member->ctx = ctx;
+		ctx->loaded = copy_puzzle(ctx, src);
+		copy_settings(ctx, src);
+		for (i = 0; i < strategies_n && strategies[i] != src->strategy; ++i);
+		ctx->strategy = strategies[(i+member->index)%strategies_n];
+		ctx->seed = src->seed+(uint64_t)member->index;
+	}
+	ctx->member = member;
+	ctx->callback = ctx->unique ? NULL:collect_solution;
+	ctx->data = member;
+	if (!ctx->loaded || !reserve_table(ctx) || !reserve_nogoods(ctx)) {
+		member->error = 1;
+		return NULL;
+	}
+	init_search(ctx);
+	add_memory(ctx, get_memory_size(ctx));
+	run_search(ctx);
+	if (!ctx->aborted && !member->error) {
+		int winner = -1;
+		__atomic_compare_exchange_n(&member->portfolio->winner, &winner, member->index, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+	}
+	return NULL;
+}
+
+static int collect_solution(void *data, const nonogram_stats_t *stats, const char *grid) {
+	member_t *member = (member_t *)data;
+	solution_t *solution;
+	if (member->solutions_n == member->solutions_size) {
+		unsigned long solutions_size = member->solutions_size ? member->solutions_size*2:16UL;
+		solution_t *solutions = realloc(member->solutions, sizeof(solution_t)*solutions_size);
+		if (!solutions) {
+			fputs("Could not reallocate memory for member->solutions\n", stderr);
+			fflush(stderr);
+			member->error = 1;
+			return 0;
+		}
+		member->solutions = solutions;
+		member->solutions_size = solutions_size;
+	}
+	solution = member->solutions+member->solutions_n;
+	solution->depth = stats->depth;
+	solution->path = NULL;
+	solution->grid = alloc_mem("solution->grid", sizeof(char), stats->cells_n);
+	if (!solution->grid) {
+		member->error = 1;
+		return 0;
+	}
+	memcpy(solution->grid, grid, (size_t)stats->cells_n);
+	++member->solutions_n;
+	return 1;
+}
+
+/* The sets of the clue are counted before it is parsed, so that its array
+is only allocated when it is too small. */
+static int parse_clue(nonogram_t *ctx, parser_t *parser, clue_t *clue, int pos, int separator) {
+	int sets_n = 1, c;
+	size_t i;
+	if (next_char(parser) != DELIMITER_CLUE) {
+		return parse_error(parser, "Double quote expected as clue start");
+	}
+	for (i = parser->pos; i < parser->size && parser->text[i] != DELIMITER_CLUE; ++i) {
+		if (parser->text[i] == SEPARATOR_SETS) {
+			++sets_n;
+		}
+	}
+	if (!reserve_clue_sets(clue, sets_n)) {
+		return 0;
+	}
+	clue->pos = pos;
+	do {
+		int len;
+		if (!parse_int(parser, &len)) {
+			return parse_error(parser, "Invalid set length");
+		}
+		c = next_char(parser);
+		if (len) {
+			int color, color_pos;
+			if (c == SEPARATOR_COLOR) {
+				color = next_char(parser);
+				if (color == EOF || !isalnum(color)) {
+					return parse_error(parser, "Invalid set color");
+				}
+				c = next_char(parser);
+			}
+			else {
+				color = COLOR_BLACK;
+			}
+			for (color_pos = COLOR_POS_BLACK; color_pos < ctx->colors_n && ctx->colors[color_pos] != color; ++color_pos);
+			if (color_pos == ctx->colors_n) {
+				if (ctx->colors_n == ctx->colors_size) {
+					return parse_error(parser, "Too many colors");
+				}
+				ctx->colors[ctx->colors_n++] = color;
+			}
+			init_set_fields(clue->sets+clue->sets_n, len, color_pos, clue);
+			++clue->sets_n;
+		}
+		if (c != SEPARATOR_SETS && c != DELIMITER_CLUE) {
+			return parse_error(parser, "Invalid set separator");
+		}
+	}
+	while (c != DELIMITER_CLUE);
+	clue->sets_header = clue->sets+clue->sets_n;
+	init_set_fields(clue->sets_header, 0, COLOR_POS_UNKNOWN, clue);
+	if (next_char(parser) != separator) {
+		return parse_error(parser, "Invalid clue separator");
+	}
+	return 1;
+}
+
+/* Room is kept for the sets and the header of the clue, the array is kept
+when the context is reused. */
+static int reserve_clue_sets(clue_t *clue, int sets_n) {
+	clue->sets_n = 0;
+	if (clue->sets_size <= sets_n) {
+		free(clue->sets);
+		clue->sets_size = 0;
+		clue->sets = alloc_mem("clue->sets", sizeof(set_t), sets_n+1);
+		if (!clue->sets) {
+			return 0;
+		}
+		clue->sets_size = sets_n+1;
+	}
+	return 1;
+}
+
+/* Reads a number that is not negative after blanks like scanf. */
+static int parse_int(parser_t *parser, int *value) {
+	while (parser->pos < parser->size && isspace((unsigned char)parser->text[parser->pos])) {
+		next_char(parser);
+	}
+	parser->column = (int)(parser->pos-parser->line_start)+1;
+	if (parser->pos == parser->size || !isdigit((unsigned char)parser->text[parser->pos])) {
+		return 0;
+	}
+	*value = 0;
+	do {
+		int digit = parser->text[parser->pos++]-'0';
+		if (*value > (INT_MAX-digit)/10) {
+			return 0;
+		}
+		*value = *value*10+digit;
+	}
+	while (parser->pos < parser->size && isdigit((unsigned char)parser->text[parser->pos]));
+	return 1;
+}
+
+static int next_char(parser_t *parser) {
+	int c;
+	if (parser->pos == parser->size) {
+		parser->column = (int)(parser->pos-parser->line_start)+1;
+		return EOF;
+	}
+	c = (unsigned char)parser->text[parser->pos++];
+	parser->column = (int)(parser->pos-parser->line_start);
+	if (c == SEPARATOR_LINES) {
+		++parser->line;
+		parser->line_start = parser->pos;
+	}
+	return c;
+}
+
+static int parse_error(const parser_t *parser, const char *message) {
+	fprintf(stderr, "Line %d column %d: %s\n", parser->line, parser->column, message);
+	fflush(stderr);
+	return 0;
+}
+
+/* Writes the value 7 bits at a time from the lowest, the high bit of a byte
+is set when more bytes follow. Nothing is written past the size of the buffer
+but the position is still advanced. */
+static size_t encode_int(unsigned char *data, size_t size, size_t pos, int value) {
+	unsigned u = (unsigned)value;
+	while (u > 0x7fU) {
+		if (pos < size) {
+			data[pos] = (unsigned char)(u & 0x7fU) | 0x80U;
+		}
+		++pos;
+		u >>= 7;
+	}
+	if (pos < size) {
+		data[pos] = (unsigned char)u;
+	}
+	return pos+1;
+}
+
+static int decode_int(const unsigned char *data, size_t size, size_t *pos, int *value) {
+	int shift = 0;
+	unsigned u = 0U;
+	do {
+		if (*pos == size || shift > 28) {
+			return 0;
+		}
+		u |= (unsigned)(data[*pos] & 0x7fU) << shift;
+		shift += 7;
+	}
+	while (data[(*pos)++] & 0x80U);
+	if (u > INT_MAX) {
+		return 0;
+	}
+	*value = (int)u;
+	return 1;
+}
+
+static int init_clue(nonogram_t *ctx, clue_t *clue) {
+	int line_len = clue->pos < ctx->width ? ctx->height:ctx->width, len_min, i;
+	clue->sets[0].empty_before = 0;
+	len_min = clue->sets[0].len;
+	for (i = 1; i < clue->sets_n; ++i) {
+		if (clue->sets[i].color_pos == clue->sets[i-1].color_pos) {
+			clue->sets[i].empty_before = 1;
+			++len_min;
+		}
+		else {
+			clue->sets[i].empty_before = 0;
+		}
+		len_min += clue->sets[i].len;
+	}
+	clue->sets[clue->sets_n].empty_before = 0;
+	if (len_min > line_len) {
+		fputs("Incompatible clue\n", stderr);
+		fflush(stderr);
+		return 0;
+	}
+	clue->relaxation = line_len-len_min;
+	clue->priority = clue->sets_n ? len_min-clue->relaxation:line_len;
+	return 1;
+}
+
+static size_t get_clue_tables_size(const clue_t *clue) {
+	size_t cache_size = (size_t)clue->relaxation+1;
+	return ((sizeof(int)*2+sizeof(option_t))*(size_t)clue->sets_n+sizeof(int))*cache_size;
+}
+
+static int init_clue_tables(nonogram_t *ctx, clue_t *clue) {
+	int line_len = clue->pos < ctx->width ? ctx->height:ctx->width, bounds_size = (clue->sets_n+1)*DEPTHS_SIZE*3, len_min, i;
+	if (clue->bounds_size < bounds_size) {
+		free(clue->bounds);
+		clue->bounds_size = 0;
+		clue->bounds = alloc_mem("clue->bounds", sizeof(int), bounds_size);
+		if (!clue->bounds) {
+			return 0;
+		}
+		clue->bounds_size = bounds_size;
+	}
+	clue->depths_size = clue->bounds_size/((clue->sets_n+1)*3);
+	link_bounds(clue);
+	len_min = 0;
+	for (i = 0; i < clue->sets_n; ++i) {
+		init_set_tables(ctx, clue->sets+i, len_min, len_min+clue->relaxation, len_min, len_min+clue->relaxation);
+		link_set(clue->sets+i, i ? clue->sets+i-1:clue->sets_header, clue->sets+i+1);
+		len_min += clue->sets[i].len+clue->sets[i].empty_before;
+	}
+	init_set_tables(ctx, clue->sets_header, len_min, line_len, line_len, line_len-1);
+	clue->saved_depth = -1;
+	clue->swept = 0;
+	clue->queue_pos = -1;
+	clue->removed = 0;
+	clue->sets_n ? link_set(clue->sets_header, clue->sets_header-1, clue->sets):link_set(clue->sets_header, clue->sets_header, clue->sets_header);
+	return 1;
+}
+
+static void init_set_fields(set_t *set, int len, int color_pos, clue_t *clue) {
+	set->len = len;
+	set->color_pos = color_pos;
+	set->clue = clue;
+	set->empty_bounds_min = NULL;
+	set->color_bounds_min = NULL;
+	set->color_bounds_max = NULL;
+	set->empty_cache = NULL;
+	set->color_cache = NULL;
+	set->options = NULL;
+	set->swept_clues = NULL;
+}
+
+static void init_set_tables(nonogram_t *ctx, set_t *set, int empty_bound_min, int empty_bound_max, int color_bound_min, int color_bound_max) {
+	int cache_size, i;
+	init_empty_bounds(set, DEPTH_CUR, empty_bound_min);
+	init_color_bounds(set, DEPTH_CUR, color_bound_min, color_bound_max);
+	init_empty_bounds(set, DEPTH_BCK, empty_bound_min);
+	init_color_bounds(set, DEPTH_BCK, color_bound_min, color_bound_max);
+	cache_size = empty_bound_max-empty_bound_min+1;
+	set->empty_cache = arena_alloc(ctx, sizeof(int), cache_size);
+	for (i = cache_size; i--; ) {
+		set->empty_cache[i] = CACHE_UNKNOWN;
+	}
+	cache_size = color_bound_max-color_bound_min+1;
+	if (cache_size) {
+		set->color_cache = arena_alloc(ctx, sizeof(int), cache_size);
+		for (i = cache_size; i--; ) {
+			set->color_cache[i] = CACHE_UNKNOWN;
+		}
+		set->options = arena_alloc(ctx, sizeof(option_t), cache_size);
+	}
+}
+
+static void link_set(set_t *set, set_t *last, set_t *next) {
+	set->last = last;
+	set->next = next;
+}
+
+static void link_clue(clue_t *clue, clue_t *last, clue_t *next) {
+	clue->last = last;
+	clue->next = next;
+}
+
+/* Bit i of the color masks stands for the color at position
+COLOR_POS_EMPTY+i, there are at most 64 of them (empty, black and 62 of
+the alphanumeric colors). */
+static void init_cell(nonogram_t *ctx, cell_t *cell, clue_t *column_clue, clue_t *row_clue) {
+	cell->column_clue = column_clue;
+	cell->row_clue = row_clue;
+	cell->color_pos = COLOR_POS_UNKNOWN;
+	cell->colors = UINT64_MAX >> (64-(ctx->colors_n-COLOR_POS_EMPTY));
+	cell->confirmed = 0;
+}
+
+static void link_column_clue(nonogram_t *ctx, clue_t *clue, cell_t *cell_first) {
+	clue->cells_header = ctx->cells+ctx->grid_size+clue->pos;
+	if (ctx->height > 1) {
+		int i;
+		link_column_cell(cell_first, clue->cells_header, cell_first+ctx->width);
+		for (i = ctx->width; i < ctx->grid_size-ctx->width; i += ctx->width) {
+			link_column_cell(cell_first+i, cell_first+i-ctx->width, cell_first+i+ctx->width);
+		}
+		link_column_cell(cell_first+i, cell_first+i-ctx->width, clue->cells_header);
+		link_column_cell(clue->cells_header, cell_first+i, cell_first);
+	}
+	else {
+		link_column_cell(cell_first, clue->cells_header, clue->cells_header);
+		link_column_cell(clue->cells_header, cell_first, cell_first);
+	}
+}
+
+static void link_column_cell(cell_t *cell, cell_t *last, cell_t *next) {
+	cell->column_last = last;
+	cell->column_next = next;
+}
+
+static void link_row_clue(nonogram_t *ctx, clue_t *clue, cell_t *cell_first) {
+	clue->cells_header = ctx->cells+ctx->grid_size+clue->pos;
+	if (ctx->width > 1) {
+		int i;
+		link_row_cell(cell_first, clue->cells_header, cell_first+1);
+		for (i = 1; i < ctx->width-1; ++i) {
+			link_row_cell(cell_first+i, cell_first+i-1, cell_first+i+1);
+		}
+		link_row_cell(cell_first+i, cell_first+i-1, clue->cells_header);
+		link_row_cell(clue->cells_header, cell_first+i, cell_first);
+	}
+	else {
+		link_row_cell(cell_first, clue->cells_header, clue->cells_header);
+		link_row_cell(clue->cells_header, cell_first, cell_first);
+	}
+}
+
+static void link_row_cell(cell_t *cell, cell_t *last, cell_t *next) {
+	cell->row_last = last;
+	cell->row_next = next;
+}
+
+/* Sweeps the clues until no cell changes, returns 1 if the node is consistent,
+0 if it failed and -1 if it was pruned or could not be searched. The result of
+an evaluated node is stored in its option. */
+static int sweep_node(nonogram_t *ctx, clue_t *clue_first, option_t *evaluated, frame_t *frame) {
+	int changes_sum, changes_n, clue_options_min;
+	uint64_t phase_start;
+	clue_t *clue, *failed_clue = NULL;
+	init_frame(ctx, frame);
+	++ctx->all_nodes_n;
+	if (ctx->depth > ctx->max_depth) {
+		ctx->max_depth = ctx->depth;
+	}
+	if (!evaluated) {
+		++ctx->run_nodes_n;
+	}
+	if (ctx->aborted || check_budget(ctx) || (ctx->worker ? !evaluated && prune_worker(ctx):ctx->solutions_n == ctx->solutions_max) || (!evaluated && check_restart(ctx))) {
+		if (evaluated) {
+			init_option(evaluated, -1, 0);
+		}
+		return -1;
+	}
+	if (evaluated && ctx->table && load_probe(ctx, evaluated)) {
+		return evaluated->r >= 0;
+	}
+	if (ctx->saved_clues_size < ctx->saved_clues_n+ctx->clues_n && !reserve_saved_clues(ctx, ctx->saved_clues_n+ctx->clues_n)) {
+		if (evaluated) {
+			init_option(evaluated, -1, 0);
+		}
+		return -1;
+	}
+	for (clue = ctx->clues_header->next; clue != ctx->clues_header; clue = clue->next) {
+		if (clue->depths_size < ctx->depth+DEPTHS_SIZE && !reallocate_bounds(ctx, clue, ctx->depth+DEPTHS_SIZE)) {
+			if (evaluated) {
+				init_option(evaluated, -1, 0);
+			}
+			return -1;
+		}
+	}
+	changes_sum = 0;
+	clue_options_min = INT_MAX;
+	if (clue_first) {
+		push_clue(ctx, clue_first, 0);
+	}
+	else {
+		for (clue = ctx->clues_header->next; clue != ctx->clues_header; clue = clue->next) {
+			push_clue(ctx, clue, 0);
+		}
+		phase_start = ctx->profile ? get_clock_ns():0;
+
+		/* The rules read the cells changed by the crossing clues, they are
+		applied again until a pass over the clues changes nothing. */
+		do {
+			changes_n = 0;
+			for (clue = ctx->clues_header->next; clue != ctx->clues_header && clue_options_min > 0; clue = clue->next) {
+				if (!clue->swept) {
+					int clue_changes_n = overlap_clue(ctx, clue);
+					if (clue_changes_n < 0) {
+						clue_options_min = 0;
+					}
+					else {
+						changes_n += clue_changes_n;
+					}
+				}
+			}
+			changes_sum += changes_n;
+		}
+		while (changes_n && clue_options_min > 0);
+		if (ctx->profile) {
+			add_phase(ctx, PHASE_SWEEP, phase_start);
+		}
+	}
+
+	/* Only the clues crossing the cells that changed are queued again, the
+	clue with the most changes is swept first. */
+	while (ctx->queued_clues_n && clue_options_min > 0) {
+		int clue_options_n, line_n, sets_first, j;
+		cell_t *cell;
+		ctx->current_clue = pop_clue(ctx);
+		save_clue(ctx, ctx->current_clue);
+		if (ctx->swept_clues) {
+			ctx->swept_clues[ctx->current_clue->pos/64] |= UINT64_C(1) << ctx->current_clue->pos%64;
+		}
+
+		/* Each cell of the clue adds at most one entry to the trail, the
+		node fails if it cannot grow. */
+		if (ctx->trail_size < ctx->trail_n+ctx->width+ctx->height && !reserve_trail(ctx, ctx->trail_n+ctx->width+ctx->height)) {
+			clue_options_min = ctx->negative_cache;
+			break;
+		}
+		if (ctx->current_clue->pos < ctx->width) {
+			ctx->offset = ctx->width;
+			cell = ctx->cells+ctx->current_clue->pos;
+			line_n = ctx->height;
+		}
+		else {
+			ctx->offset = 1;
+			cell = ctx->cells+(ctx->current_clue->pos-ctx->width)*ctx->width;
+			line_n = ctx->width;
+		}
+
+		/* The generic sweep is cheaper when the sets have little room left
+		to move. */
+		if (!ctx->line_bits || line_n > LINE_BITS_MAX || get_clue_slack(ctx->current_clue) < line_n) {
+			line_n = 0;
+		}
+		phase_start = ctx->profile ? get_clock_ns():0;
+		if (line_n) {
+			sets_first = 0;
+			clue_options_n = sweep_line_bits(ctx, ctx->current_clue, cell, line_n);
+		}
+		else {
+			int pos = 0;
+			sets_first = ctx->current_clue->swept ? get_fixed_sets_n(ctx->current_clue, &pos):0;
+			clue_options_n = sweep_clue(ctx, ctx->current_clue->sets+sets_first, pos, cell+pos*ctx->offset);
+		}
+		ctx->current_clue->swept = 1;
+		if (ctx->profile) {
+			add_phase(ctx, PHASE_SWEEP, phase_start);
+		}
+		if (clue_options_n <= 0) {
+			failed_clue = ctx->current_clue;
+			if (ctx->restart_nodes) {
+				++ctx->current_clue->failures;
+			}
+		}
+		if (clue_options_n < clue_options_min) {
+			clue_options_min = clue_options_n;
+			if (clue_options_min == ctx->negative_cache) {
+				break;
+			}
+		}
+		changes_n = 0;
+		if (ctx->current_clue->pos < ctx->width) {
+			for (cell = ctx->current_clue->cells_header->column_next; cell != ctx->current_clue->cells_header; cell = cell->column_next) {
+				changes_n += check_cell_colors(ctx, cell);
+			}
+		}
+		else {
+			for (cell = ctx->current_clue->cells_header->row_next; cell != ctx->current_clue->cells_header; cell = cell->row_next) {
+				changes_n += check_cell_colors(ctx, cell);
+			}
+		}
+		if (line_n) {
+			for (j = 0; j < ctx->current_clue->sets_n; ++j) {
+				update_color_bounds_and_cache(ctx->current_clue->sets[j].color_bounds_min, ctx->current_clue->sets[j].color_bounds_max, ctx->current_clue->sets[j].color_cache);
+			}
+		}
+		else {
+			for (j = sets_first; j < ctx->current_clue->sets_n; ++j) {
+				update_empty_bound_and_cache(ctx->current_clue->sets[j].empty_bounds_min, ctx->current_clue->sets[j].color_bounds_max, ctx->current_clue->sets[j].empty_cache);
+				update_color_bounds_and_cache(ctx->current_clue->sets[j].color_bounds_min, ctx->current_clue->sets[j].color_bounds_max, ctx->current_clue->sets[j].color_cache);
+			}
+			update_empty_bound_and_cache(ctx->current_clue->sets[j].empty_bounds_min, ctx->current_clue->sets[j].color_bounds_min, ctx->current_clue->sets[j].empty_cache);
+		}
+		if (clue_options_n == 1) {
+			ctx->current_clue->last->next = ctx->current_clue->next;
+			ctx->current_clue->next->last = ctx->current_clue->last;
+			ctx->locked_clues[ctx->locked_clues_n++] = ctx->current_clue;
+			if (ctx->table) {
+				ctx->hash ^= mix_hash((uint64_t)(ctx->current_clue->pos+1)*HASH_CLUE);
+			}
+		}
+		if (clue_options_min <= 0) {
+			break;
+		}
+		changes_sum += changes_n;
+	}
+	while (ctx->queued_clues_n) {
+		clue = ctx->queued_clues[--ctx->queued_clues_n];
+		clue->queue_pos = -1;
+		clue->priority = 0;
+	}
+	if (clue_options_min <= 0) {
+		if (evaluated) {
+			init_option(evaluated, -1, 0);
+
+			/* Not kept when the trail could not grow. */
+			if (ctx->table && failed_clue) {
+				store_probe(ctx, evaluated, failed_clue);
+			}
+		}
+		return 0;
+	}
+	if (evaluated) {
+		ctx->clues_header->next != ctx->clues_header ? init_option(evaluated, 0, changes_sum):init_option(evaluated, 1, changes_sum);
+		if (ctx->table) {
+			store_probe(ctx, evaluated, NULL);
+		}
+	}
+	return 1;
+}
+
+/* A probe made again from the same state gives the same result, the clues it
+swept and the failure of its clue are counted again as if it was searched. */
+static int load_probe(nonogram_t *ctx, option_t *option) {
+	size_t index = (size_t)(ctx->probe_key & (ctx->table_size-1));
+	const table_entry_t *entry = ctx->table+index;
+	if (entry->key != ctx->probe_key) {
+		++ctx->counters.table_misses_n;
+		return 0;
+	}
+	++ctx->counters.table_hits_n;
+	memcpy(ctx->probe_clues, ctx->table_clues+index*(size_t)ctx->clue_words_n, sizeof(uint64_t)*(size_t)ctx->clue_words_n);
+	if (entry->failed_clue >= 0 && ctx->restart_nodes) {
+		++ctx->clues[entry->failed_clue].failures;
+	}
+	init_option(option, entry->r, entry->changes_sum);
+	return 1;
+}
+
+static void store_probe(nonogram_t *ctx, const option_t *option, const clue_t *failed_clue) {
+	size_t index = (size_t)(ctx->probe_key & (ctx->table_size-1));
+	table_entry_t *entry = ctx->table+index;
+	entry->key = ctx->probe_key;
+	entry->r = option->r;
+	entry->changes_sum = option->changes_sum;
+	entry->failed_clue = failed_clue ? failed_clue->pos:-1;
+	memcpy(ctx->table_clues+index*(size_t)ctx->clue_words_n, ctx->probe_clues, sizeof(uint64_t)*(size_t)ctx->clue_words_n);
+}
+
+static void init_frame(nonogram_t *ctx, frame_t *frame) {
+	frame->set_min = NULL;
+	frame->locked_cells_n_bak = ctx->locked_cells_n;
+	frame->locked_clues_n_bak = ctx->locked_clues_n;
+	frame->locked_sets_n_bak = ctx->locked_sets_n;
+	frame->trail_n_bak = ctx->trail_n;
+	frame->saved_clues_n_bak = ctx->saved_clues_n;
+	frame->hash_bak = ctx->hash;
+}
+
+/* The search runs on the frames of the context instead of the call stack, the
+frame of each depth holds the set chosen for branching, the rank of the option
+searched and the sizes to restore when the node is left. */
+static void nonogram(nonogram_t *ctx) {
+	int depth_min = ctx->depth;
+	frame_t *frame = ctx->frames+ctx->depth;
+
+	/* A checkpoint at the depth of the root only holds the statistics. */
+	if (ctx->resume.path && ctx->depth == ctx->resume.depth) {
+		resume_search(ctx);
+	}
+	enter_node(ctx, NULL, frame);
+	while (1) {
+		if (frame->set_min && frame->rank < (ctx->worker ? get_rank_end(ctx):frame->set_min->options_n)) {
+			int i = frame->set_min->options_n-1-frame->rank;
+			if (ctx->depth == ctx->completed_depth && i == frame->set_min->options_n-1) {
+				ctx->completed_depth = ctx->depth+1;
+			}
+			if (ctx->worker) {
+				enter_frame(ctx, frame->rank);
+			}
+			frame->set_min->color_cache[frame->set_min->options[i].pos-frame->set_min->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+			if (ctx->table) {
+				ctx->hash ^= hash_option(frame->set_min, frame->set_min->options[i].pos, HASH_MARK);
+			}
+			++ctx->depth;
+			--ctx->negative_cache;
+			if (ctx->resume.path && ctx->depth == ctx->resume.depth) {
+				resume_search(ctx);
+			}
+			else if (ctx->checkpoint && get_time(ctx) >= ctx->checkpoint_time) {
+				write_checkpoint(ctx);
+			}
+			enter_node(ctx, frame->set_min->clue, frame+1);
+			++frame;
+		}
+		else {
+			/* The path of a checkpoint only goes down, the search is stopped
+			like when the callback returns 0 if a node is left before. */
+			if (ctx->resume.path) {
+				fputs("Checkpoint does not match the search\n", stderr);
+				fflush(stderr);
+				free_ints(&ctx->resume.path);
+				ctx->resume.depth = -1;
+				ctx->solutions_max = ctx->solutions_n;
+			}
+			leave_node(ctx, frame);
+			if (ctx->depth == depth_min) {
+				break;
+			}
+			++ctx->negative_cache;
+			--ctx->depth;
+			--frame;
+			frame->set_min->color_cache[frame->set_min->options[frame->set_min->options_n-1-frame->rank].pos-frame->set_min->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+			if (ctx->table) {
+				ctx->hash ^= hash_option(frame->set_min, frame->set_min->options[frame->set_min->options_n-1-frame->rank].pos, HASH_MARK);
+			}
+			++frame->rank;
+		}
+	}
+}
+
+/* Chooses the set to branch on after the sweeps, the frame is left without a
+set when the node failed or is a solution. */
+static void enter_node(nonogram_t *ctx, clue_t *clue_first, frame_t *frame) {
+	int changes_n, sorted_sets_n, probes_n, i;
+	uint64_t phase_start;
+	clue_t *clue;
+	set_t *set_min;
+	changes_n = sweep_node(ctx, clue_first, NULL, frame);
+	if (changes_n <= 0) {
+		if (!changes_n && !ctx->aborted) {
+			++ctx->counters.sweep_failures_n;
+			learn_nogood(ctx, NULL);
+		}
+		return;
+	}
+	if (ctx->clues_header->next == ctx->clues_header) {
+		++ctx->solutions_n;
+		if (ctx->worker) {
+			record_solution(ctx);
+		}
+		else {
+			report_solution(ctx);
+		}
+		return;
+	}
+	if (ctx->trace) {
+		fprintf(ctx->trace, "\nTime %.6fs\nAll nodes %" PRIu64 "\nRun nodes %" PRIu64 "\nFailures %" PRIu64 "\nDepth %d Completed %d\nCells %d Locked %u\n", get_time(ctx), ctx->all_nodes_n, ctx->run_nodes_n, ctx->failures_n, ctx->depth, ctx->completed_depth, ctx->grid_size, ctx->locked_cells_n);
+		fflush(ctx->trace);
+	}
+	sorted_sets_n = 0;
+	for (clue = ctx->clues_header->next; clue != ctx->clues_header; clue = clue->next) {
+		set_t *set;
+		for (set = clue->sets_header->next; set != clue->sets_header; set = set->next) {
+			if (set->color_bounds_min[DEPTH_CUR] == set->color_bounds_max[DEPTH_CUR]) {
+				set->last->next = set->next;
+				set->next->last = set->last;
+				ctx->locked_sets[ctx->locked_sets_n++] = set;
+			}
+		}
+		for (set = clue->sets_header->next; set != clue->sets_header; set = set->next) {
+			set->options_n = 0;
+			set->solutions_n = 0;
+			set->changes_sum = 0;
+			set->skipped = 0;
+			set->probed = 0;
+			for (i = set->color_bounds_min[DEPTH_CUR]; i <= set->color_bounds_max[DEPTH_CUR]; ++i) {
+				if (set->color_cache[i-set->color_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
+					if (ctx->nogoods_n && check_nogoods(ctx, set, i)) {
+						remove_option(ctx, set, i);
+					}
+					else {
+						set->options[set->options_n].tie = set->tie ? (unsigned)mix_hash(set->tie+(uint64_t)i):0U;
+						set->options[set->options_n++].pos = i;
+					}
+				}
+			}
+
+			/* The node fails when the nogoods ruled out all the options of a
+			set, it is not learned again. */
+			if (!set->options_n) {
+				++ctx->failures_n;
+				return;
+			}
+			set->others_n = set->options_n;
+			ctx->sorted_sets[sorted_sets_n++] = set;
+		}
+	}
+	/* The adaptive limit depends on the nodes searched before, it is read
+	from the checkpoint or from the stolen task on its path so that the same
+	sets are chosen. */
+	if (ctx->resume.path && ctx->depth < ctx->resume.depth) {
+		ctx->probes_limit = ctx->resume.limits[ctx->depth];
+	}
+	else if (ctx->worker && ctx->worker->ranged && ctx->depth <= ctx->worker->base_depth) {
+		ctx->probes_limit = ctx->worker->limits[ctx->depth];
+	}
+	frame->probes_limit = ctx->probes_limit;
+	probes_n = get_probes_n(ctx, sorted_sets_n);
+	ctx->node_probes_n = 0;
+	if (probes_n) {
+		int removed_n = 0;
+		do {
+			phase_start = ctx->profile ? get_clock_ns():0;
+			qsort(ctx->sorted_sets, (size_t)sorted_sets_n, sizeof(set_t *), compare_sets);
+			if (ctx->profile) {
+				add_phase(ctx, PHASE_SELECT, phase_start);
+			}
+			changes_n = check_set_stale(ctx, ctx->sorted_sets[0]) ? evaluate_set(ctx, ctx->sorted_sets[0]):0;
+			if (ctx->unique && ctx->solutions_n == ctx->solutions_max) {
+				return;
+			}
+			set_min = init_set_min(ctx, ctx->sorted_sets[0]);
+			if (set_min->others_n > 1) {
+				for (i = 1; i < probes_n; ++i) {
+					if (check_set_stale(ctx, ctx->sorted_sets[i])) {
+						if (!ctx->probes_budget || ctx->node_probes_n < ctx->probes_budget) {
+							changes_n += evaluate_set(ctx, ctx->sorted_sets[i]);
+							if (ctx->unique && ctx->solutions_n == ctx->solutions_max) {
+								return;
+							}
+						}
+						else if (!ctx->sorted_sets[i]->probed) {
+							continue;
+						}
+					}
+					if (compare_evaluations(ctx->sorted_sets[i], set_min) < 0) {
+						set_min = init_set_min(ctx, ctx->sorted_sets[i]);
+						if (set_min->others_n < 2) {
+							break;
+						}
+					}
+				}
+			}
+			if (ctx->trace) {
+				fprintf(ctx->trace, "Removed options %d\n", changes_n);
+				fflush(ctx->trace);
+			}
+			removed_n += changes_n;
+		}
+		while (changes_n && set_min->others_n > 1);
+		update_probes_limit(ctx, removed_n);
+	}
+	else {
+		phase_start = ctx->profile ? get_clock_ns():0;
+		set_min = ctx->sorted_sets[0];
+		for (i = 1; i < sorted_sets_n; ++i) {
+			if (compare_sets(ctx->sorted_sets+i, &set_min) < 0) {
+				set_min = ctx->sorted_sets[i];
+			}
+		}
+		for (i = 0; i < set_min->options_n; ++i) {
+			init_option(set_min->options+i, 0, 0);
+		}
+		if (ctx->profile) {
+			add_phase(ctx, PHASE_SELECT, phase_start);
+		}
+	}
+	if (!set_min->options_n) {
+		if (!ctx->aborted) {
+			++ctx->failures_n;
+			learn_nogood(ctx, set_min);
+		}
+		return;
+	}
+	qsort(set_min->options, (size_t)set_min->options_n, sizeof(option_t), compare_options);
+	for (i = set_min->options_n; i--; ) {
+		set_min->color_cache[set_min->options[i].pos-set_min->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+		if (ctx->table) {
+			ctx->hash ^= hash_option(set_min, set_min->options[i].pos, HASH_MARK);
+		}
+	}
+	frame->set_min = set_min;
+	if (ctx->worker) {
+		frame->rank = open_frame(ctx, set_min->options_n, frame->probes_limit);
+	}
+	else if (ctx->resume.path && ctx->depth < ctx->resume.depth) {
+		frame->rank = ctx->resume.path[ctx->depth];
+	}
+	else {
+		frame->rank = 0;
+	}
+}
+
+/* Returns the number of sets probed at the node among those sorted by their
+evaluation, 0 to branch on the set with the fewest options without probing.
+At the first round of evaluations of a node the sets are sorted by their
+number of options. */
+static int get_probes_n(const nonogram_t *ctx, int sorted_sets_n) {
+	switch (ctx->strategy) {
+	case NONOGRAM_STRATEGY_FEWEST:
+		return 0;
+	case NONOGRAM_STRATEGY_TOP:
+		return ctx->probes_max < sorted_sets_n ? ctx->probes_max:sorted_sets_n;
+	case NONOGRAM_STRATEGY_ADAPTIVE:
+		return ctx->probes_limit < sorted_sets_n ? ctx->probes_limit:sorted_sets_n;
+	default:
+		return sorted_sets_n;
+	}
+}
+
+/* The adaptive limit is halved at each node where the probes did not remove
+any option, and doubled otherwise. */
+static void update_probes_limit(nonogram_t *ctx, int removed_n) {
+	if (ctx->strategy != NONOGRAM_STRATEGY_ADAPTIVE) {
+		return;
+	}
+	if (removed_n) {
+		if (ctx->probes_limit < ctx->sets_n) {
+			ctx->probes_limit *= 2;
+		}
+	}
+	else if (ctx->probes_limit > 1) {
+		ctx->probes_limit /= 2;
+	}
+}
+
+static void leave_node(nonogram_t *ctx, const frame_t *frame) {
+	uint64_t phase_start;
+	if (frame->set_min) {
+		int i;
+		if (ctx->worker) {
+			close_frame(ctx);
+		}
+		for (i = frame->set_min->options_n; i--; ) {
+			frame->set_min->color_cache[frame->set_min->options[i].pos-frame->set_min->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+		}
+	}
+	while (ctx->locked_sets_n > frame->locked_sets_n_bak) {
+		uncover_set(ctx->locked_sets[--ctx->locked_sets_n]);
+	}
+	phase_start = ctx->profile ? get_clock_ns():0;
+	while (ctx->locked_clues_n > frame->locked_clues_n_bak) {
+		uncover_clue(ctx->locked_clues[--ctx->locked_clues_n]);
+	}
+	while (ctx->locked_cells_n > frame->locked_cells_n_bak) {
+		uncover_cell(ctx->locked_cells[--ctx->locked_cells_n]);
+	}
+	while (ctx->trail_n > frame->trail_n_bak) {
+		--ctx->trail_n;
+		ctx->trail[ctx->trail_n].cell->colors = ctx->trail[ctx->trail_n].colors;
+	}
+	while (ctx->saved_clues_n > frame->saved_clues_n_bak) {
+		restore_clue(ctx, ctx->saved_clues+--ctx->saved_clues_n);
+	}
+	ctx->hash = frame->hash_bak;
+	if (ctx->profile) {
+		add_phase(ctx, PHASE_BACKTRACK, phase_start);
+	}
+}
+
+static void init_option(option_t *option, int r, int changes_sum) {
+	option->r = r;
+	option->changes_sum = changes_sum;
+}
+
+/* The bounds of all the sets of a clue share one block, its depth capacity is
+doubled when exceeded. */
+static int reallocate_bounds(nonogram_t *ctx, clue_t *clue, int depths_size) {
+	int sets_size = clue->sets_n+1, *bounds, i;
+	if (depths_size < clue->depths_size*2) {
+		depths_size = clue->depths_size*2;
+	}
+	bounds = realloc_mem("clue->bounds", clue->bounds, sizeof(int), sets_size*depths_size*3);
+	if (!bounds) {
+		return 0;
+	}
+	add_memory(ctx, sizeof(int)*(size_t)(sets_size*depths_size*3-clue->bounds_size));
+	for (i = sets_size*3; --i > 0; ) {
+		memmove(bounds+i*depths_size, bounds+i*clue->depths_size, sizeof(int)*(size_t)clue->depths_size);
+	}
+	clue->bounds = bounds;
+	clue->bounds_size = sets_size*depths_size*3;
+	clue->depths_size = depths_size;
+	link_bounds(clue);
+	return 1;
+}
+
+/* Each clue is saved at most once by a node. */
+static int reserve_saved_clues(nonogram_t *ctx, int saved_clues_size) {
+	saved_clue_t *saved_clues;
+	if (saved_clues_size < ctx->saved_clues_size*2) {
+		saved_clues_size = ctx->saved_clues_size*2;
+	}
+	saved_clues = realloc_mem("saved_clues", ctx->saved_clues, sizeof(saved_clue_t), saved_clues_size);
+	if (!saved_clues) {
+		return 0;
+	}
+	add_memory(ctx, sizeof(saved_clue_t)*(size_t)(saved_clues_size-ctx->saved_clues_size));
+	ctx->saved_clues = saved_clues;
+	ctx->saved_clues_size = saved_clues_size;
+	return 1;
+}
+
+/* Backs up the bounds of the clue before the node changes its sets for the
+first time, only the clues saved are restored when the node is left. */
+static void save_clue(nonogram_t *ctx, clue_t *clue) {
+	int i;
+	if (clue->saved_depth == ctx->depth) {
+		return;
+	}
+	ctx->saved_clues[ctx->saved_clues_n].clue = clue;
+	ctx->saved_clues[ctx->saved_clues_n++].saved_depth = clue->saved_depth;
+	clue->saved_depth = ctx->depth;
+	for (i = clue->sets_n+1; i--; ) {
+		init_empty_bounds(clue->sets+i, ctx->depth+DEPTH_BCK, clue->sets[i].empty_bounds_min[DEPTH_CUR]);
+		init_color_bounds(clue->sets+i, ctx->depth+DEPTH_BCK, clue->sets[i].color_bounds_min[DEPTH_CUR], clue->sets[i].color_bounds_max[DEPTH_CUR]);
+	}
+}
+
+static void restore_clue(nonogram_t *ctx, const saved_clue_t *saved_clue) {
+	int i;
+	clue_t *clue = saved_clue->clue;
+	for (i = 0; i < clue->sets_n; ++i) {
+		clear_set_negative_cache(ctx, clue->sets[i].color_bounds_min, clue->sets[i].color_bounds_max, clue->sets[i].color_cache);
+		clear_set_negative_cache(ctx, clue->sets[i].empty_bounds_min, clue->sets[i].color_bounds_max, clue->sets[i].empty_cache);
+		init_color_bounds(clue->sets+i, DEPTH_CUR, clue->sets[i].color_bounds_min[ctx->depth+DEPTH_BCK], clue->sets[i].color_bounds_max[ctx->depth+DEPTH_BCK]);
+		init_empty_bounds(clue->sets+i, DEPTH_CUR, clue->sets[i].empty_bounds_min[ctx->depth+DEPTH_BCK]);
+	}
+	clear_set_negative_cache(ctx, clue->sets[i].empty_bounds_min, clue->sets[i].color_bounds_min, clue->sets[i].empty_cache);
+	init_empty_bounds(clue->sets+i, DEPTH_CUR, clue->sets[i].empty_bounds_min[ctx->depth+DEPTH_BCK]);
+	clue->saved_depth = saved_clue->saved_depth;
+
+	/* The clue is saved before its first sweep, the fixed sets are swept
+	again when the search starts over from the root. */
+	if (clue->saved_depth < 0) {
+		clue->swept = 0;
+	}
+}
+
+static void link_bounds(clue_t *clue) {
+	int i;
+	for (i = 0; i <= clue->sets_n; ++i) {
+		clue->sets[i].empty_bounds_min = clue->bounds+i*clue->depths_size*3;
+		clue->sets[i].color_bounds_min = clue->sets[i].empty_bounds_min+clue->depths_size;
+		clue->sets[i].color_bounds_max = clue->sets[i].color_bounds_min+clue->depths_size;
+	}
+}
+
+static int compare_priorities(const void *a, const void *b) {
+	clue_t *clue_a = *(clue_t * const *)a, *clue_b = *(clue_t * const *)b;
+	if (clue_a->priority != clue_b->priority) {
+		return clue_b->priority-clue_a->priority;
+	}
+	return clue_a->pos-clue_b->pos;
+}
+
+/* The queue of the clues to sweep is a binary heap ordered like
+compare_priorities, the priority of a queued clue only grows. */
+static void push_clue(nonogram_t *ctx, clue_t *clue, int changes_n) {
+	int i;
+	clue->priority += changes_n;
+	if (clue->queue_pos < 0) {
+		clue->queue_pos = ctx->queued_clues_n++;
+	}
+	for (i = clue->queue_pos; i && compare_priorities(&clue, ctx->queued_clues+(i-1)/2) < 0; i = (i-1)/2) {
+		ctx->queued_clues[i] = ctx->queued_clues[(i-1)/2];
+		ctx->queued_clues[i]->queue_pos = i;
+	}
+	ctx->queued_clues[i] = clue;
+	clue->queue_pos = i;
+}
+
+/* The priority of the clue is cleared so that it counts the changes made
+after its sweep. */
+static clue_t *pop_clue(nonogram_t *ctx) {
+	int i, j;
+	clue_t *clue = ctx->queued_clues[0], *last = ctx->queued_clues[--ctx->queued_clues_n];
+	for (i = 0; (j = i*2+1) < ctx->queued_clues_n; i = j) {
+		if (j+1 < ctx->queued_clues_n && compare_priorities(ctx->queued_clues+j+1, ctx->queued_clues+j) < 0) {
+			++j;
+		}
+		if (compare_priorities(ctx->queued_clues+j, &last) >= 0) {
+			break;
+		}
+		ctx->queued_clues[i] = ctx->queued_clues[j];
+		ctx->queued_clues[i]->queue_pos = i;
+	}
+	if (ctx->queued_clues_n) {
+		ctx->queued_clues[i] = last;
+		last->queue_pos = i;
+	}
+	clue->queue_pos = -1;
+	clue->priority = 0;
+	return clue;
+}
+
+/* Rules applied to a clue before its first sweep, that only look at the
+bounds of its sets and at the colors left in its cells. A set starts where the
+cells can take its color and are not next to a cell left with its color only
+(edge rule), and a cell that cannot be empty between the left-most positions
+of two sets is covered by the first one, or by the second one for the
+right-most positions (glue rule). The bounds are tightened this way until they
+do not move. A cell may then only take empty or the colors of the sets that can
+cover it, and takes the color of a set when it lies between the start of its
+right-most position and the end of its left-most one. Returns the number of
+colors removed, -1 if a set has no position or a cell no color left. */
+static int overlap_clue(nonogram_t *ctx, clue_t *clue) {
+	int line_n, changes_n, failed, moved, i;
+	cell_t *start_cell, *cell;
+	if (clue->pos < ctx->width) {
+		ctx->offset = ctx->width;
+		start_cell = ctx->cells+clue->pos;
+		line_n = ctx->height;
+	}
+	else {
+		ctx->offset = 1;
+		start_cell = ctx->cells+(clue->pos-ctx->width)*ctx->width;
+		line_n = ctx->width;
+	}
+	if (ctx->trail_size < ctx->trail_n+line_n && !reserve_trail(ctx, ctx->trail_n+line_n)) {
+		return -1;
+	}
+	for (i = 0; i < clue->sets_n; ++i) {
+		clue->sets[i].overlap_min = clue->sets[i].color_bounds_min[DEPTH_CUR]+clue->sets[i].empty_before;
+		clue->sets[i].overlap_max = clue->sets[i].color_bounds_max[DEPTH_CUR]+clue->sets[i].empty_before;
+	}
+
+	/* The left-most starts only move right. */
+	do {
+		moved = 0;
+		for (i = 0; i < clue->sets_n; ++i) {
+			set_t *set = clue->sets+i;
+			if (i && set->overlap_min < set[-1].overlap_min+set[-1].len+set->empty_before) {
+				set->overlap_min = set[-1].overlap_min+set[-1].len+set->empty_before;
+			}
+			while (set->overlap_min <= set->overlap_max && !check_set_fit(ctx, set, start_cell, line_n, set->overlap_min)) {
+				++set->overlap_min;
+			}
+			if (set->overlap_min > set->overlap_max) {
+				return -1;
+			}
+		}
+		for (i = clue->sets_n; i--; ) {
+			set_t *set = clue->sets+i;
+			int j = (i+1 < clue->sets_n ? set[1].overlap_min:line_n)-1;
+			for (cell = start_cell+j*ctx->offset; j >= set->overlap_min+set->len && cell->colors & 1; --j, cell -= ctx->offset);
+			if (j >= set->overlap_min+set->len) {
+				set->overlap_min = cell->colors >> (set->color_pos-COLOR_POS_EMPTY) & 1 ? j-set->len+1:j+1;
+				moved = 1;
+			}
+		}
+	}
+	while (moved);
+
+	/* The right-most starts only move left. */
+	do {
+		moved = 0;
+		for (i = clue->sets_n; i--; ) {
+			set_t *set = clue->sets+i;
+			if (i+1 < clue->sets_n && set->overlap_max > set[1].overlap_max-set[1].empty_before-set->len) {
+				set->overlap_max = set[1].overlap_max-set[1].empty_before-set->len;
+			}
+			while (set->overlap_max >= set->overlap_min && !check_set_fit(ctx, set, start_cell, line_n, set->overlap_max)) {
+				--set->overlap_max;
+			}
+			if (set->overlap_max < set->overlap_min) {
+				return -1;
+			}
+		}
+		for (i = 0; i < clue->sets_n; ++i) {
+			set_t *set = clue->sets+i;
+			int j = i ? set[-1].overlap_max+set[-1].len:0;
+			for (cell = start_cell+j*ctx->offset; j < set->overlap_max && cell->colors & 1; ++j, cell += ctx->offset);
+			if (j < set->overlap_max) {
+				set->overlap_max = cell->colors >> (set->color_pos-COLOR_POS_EMPTY) & 1 ? j:j-set->len;
+				moved = 1;
+			}
+		}
+	}
+	while (moved);
+	for (i = 0, cell = start_cell; i < line_n; ++i, cell += ctx->offset) {
+		cell->confirmed = 1;
+	}
+	for (i = 0; i < clue->sets_n; ++i) {
+		const set_t *set = clue->sets+i;
+		int j;
+		uint64_t color = (uint64_t)1 << (set->color_pos-COLOR_POS_EMPTY);
+		for (j = set->overlap_min, cell = start_cell+j*ctx->offset; j < set->overlap_max+set->len; ++j, cell += ctx->offset) {
+			cell->confirmed = j >= set->overlap_max && j < set->overlap_min+set->len ? color:cell->confirmed | color;
+		}
+	}
+	ctx->current_clue = clue;
+	changes_n = 0;
+	failed = 0;
+	for (i = 0, cell = start_cell; i < line_n; ++i, cell += ctx->offset) {
+		if (cell->color_pos > COLOR_POS_SEVERAL) {
+			cell->confirmed = 0;
+		}
+		else {
+			cell->confirmed &= cell->colors;
+			if (!cell->confirmed) {
+				failed = 1;
+			}
+			changes_n += check_cell_colors(ctx, cell);
+		}
+	}
+	return failed ? -1:changes_n;
+}
+
+/* Returns 1 if the set may start at pos: its cells can all take its color,
+and the cells around them are not left with its color only. */
+static int check_set_fit(const nonogram_t *ctx, const set_t *set, const cell_t *start_cell, int line_n, int pos) {
+	int i;
+	uint64_t color = (uint64_t)1 << (set->color_pos-COLOR_POS_EMPTY);
+	const cell_t *cell = start_cell+pos*ctx->offset;
+	if ((pos > 0 && (cell-ctx->offset)->colors == color) || (pos+set->len < line_n && (cell+set->len*ctx->offset)->colors == color)) {
+		return 0;
+	}
+	for (i = 0; i < set->len && cell->colors & color; ++i, cell += ctx->offset);
+	return i == set->len;
+}
+
+static int sweep_clue(nonogram_t *ctx, set_t *set, int pos, cell_t *start_cell) {
+	int i;
+	cell_t *cell;
+	for (i = pos, cell = start_cell; i < set->color_bounds_min[DEPTH_CUR] && cell->colors & 1; ++i, cell += ctx->offset);
+	if (i >= set->color_bounds_min[DEPTH_CUR]) {
+		int r_sum = 0;
+		cell_t *last_ok_cell = start_cell;
+		if (set != ctx->current_clue->sets_header) {
+			int j, len = 0, last_ok = i, sum;
+			cell_t *colored_cell;
+			for (j = i; j <= set->color_bounds_max[DEPTH_CUR]; ++j, cell += ctx->offset) {
+				++ctx->counters.color_cache_lookups_n;
+				if (set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] != CACHE_UNKNOWN) {
+					++ctx->counters.color_cache_hits_n;
+					len = 0;
+					if (set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] > CACHE_UNKNOWN) {
+						r_sum = sum_with_limit(r_sum, set->color_cache[j-set->color_bounds_min[DEPTH_BCK]]);
+						last_ok_cell = cell;
+						last_ok = j;
+					}
+					if (!(cell->colors & 1)) {
+						++j;
+						break;
+					}
+				}
+				else {
+					int r;
+					if (set->empty_before) {
+						if (cell->colors & 1) {
+							r = sweep_set(ctx, set, j+1, cell+ctx->offset, &colored_cell, &len);
+							if (r > 0) {
+								cell->confirmed |= 1;
+							}
+						}
+						else {
+							len = 0;
+							r = ctx->negative_cache;
+						}
+					}
+					else {
+						r = sweep_set(ctx, set, j, cell, &colored_cell, &len);
+					}
+					if (r > 0) {
+						set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] = r;
+						r_sum = sum_with_limit(r_sum, r);
+						last_ok_cell = cell;
+						last_ok = j;
+					}
+					else {
+						set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+						if (len > 0) {
+							int k;
+							if (j+len < set->color_bounds_max[DEPTH_CUR]) {
+								k = j+len;
+							}
+							else {
+								if (!(cell->colors & 1) || !r) {
+									for (k = set->color_bounds_max[DEPTH_CUR]; k > j; --k) {
+										if (set->empty_cache[k-set->empty_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
+											set->empty_cache[k-set->empty_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+										}
+									}
+								}
+								k = set->color_bounds_max[DEPTH_CUR];
+							}
+							for (; k > j; --k) {
+								if (set->color_cache[k-set->color_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
+									set->color_cache[k-set->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+								}
+							}
+						}
+					}
+					if (!(cell->colors & 1) || !r) {
+						++j;
+						break;
+					}
+					if (len > 0) {
+						if (j+len < set->color_bounds_max[DEPTH_CUR]) {
+							j += len;
+							cell += len*ctx->offset;
+						}
+						else {
+							j = set->color_bounds_max[DEPTH_CUR];
+						}
+					}
+				}
+			}
+			for (--j; j > last_ok; --j) {
+				if (set->empty_cache[j-set->empty_bounds_min[DEPTH_BCK]] == CACHE_UNKNOWN) {
+					set->empty_cache[j-set->empty_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+				}
+			}
+			sum = 0;
+			for (; j > i; --j) {
+				if (set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] > CACHE_UNKNOWN) {
+					sum = sum_with_limit(sum, set->color_cache[j-set->color_bounds_min[DEPTH_BCK]]);
+				}
+				set->empty_cache[j-set->empty_bounds_min[DEPTH_BCK]] = sum;
+			}
+		}
+		else {
+			++r_sum;
+			last_ok_cell = cell;
+		}
+		for (cell = last_ok_cell-ctx->offset; cell >= start_cell; cell -= ctx->offset) {
+			cell->confirmed |= 1;
+		}
+		if (r_sum) {
+			for (; i >= pos; --i) {
+				set->empty_cache[i-set->empty_bounds_min[DEPTH_BCK]] = r_sum;
+			}
+			return r_sum;
+		}
+	}
+	for (; i >= pos; --i) {
+		set->empty_cache[i-set->empty_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+	}
+	return ctx->negative_cache;
+}
+
+static int sweep_set(nonogram_t *ctx, set_t *set, int pos, cell_t *start_cell, cell_t **colored_cell, int *len) {
+	int next_pos = pos+set->len, i;
+	cell_t *cell;
+	if (*len == -1) {
+		i = next_pos-1;
+		start_cell += (set->len-1)*ctx->offset;
+	}
+	else {
+		*colored_cell = NULL;
+		i = pos;
+	}
+	for (cell = start_cell; i < next_pos; ++i, cell += ctx->offset) {
+		if (!(cell->colors & 1) && !*colored_cell) {
+			*colored_cell = cell;
+		}
+		if (!(cell->colors >> (set->color_pos-COLOR_POS_EMPTY) & 1)) {
+			break;
+		}
+	}
+	if (i == next_pos) {
+		int r;
+		set_t *next_set = set+1;
+		++ctx->counters.empty_cache_lookups_n;
+		if (next_set->empty_cache[next_pos-next_set->empty_bounds_min[DEPTH_BCK]] != CACHE_UNKNOWN) {
+			++ctx->counters.empty_cache_hits_n;
+			r = next_set->empty_cache[next_pos-next_set->empty_bounds_min[DEPTH_BCK]];
+		}
+		else {
+			r = sweep_clue(ctx, next_set, next_pos, cell);
+		}
+		if (r > 0) {
+			for (cell -= ctx->offset; cell >= start_cell; cell -= ctx->offset) {
+				cell->confirmed |= (uint64_t)1 << (set->color_pos-COLOR_POS_EMPTY);
+			}
+			*len = -1;
+		}
+		else {
+			*len = 0;
+		}
+		return r;
+	}
+	*len = i-pos;
+	if (*colored_cell) {
+		return 0;
+	}
+	return ctx->negative_cache;
+}
+
+static int get_clue_slack(const clue_t *clue) {
+	int slack = 0, i;
+	for (i = 0; i < clue->sets_n; ++i) {
+		slack += clue->sets[i].color_bounds_max[DEPTH_CUR]-clue->sets[i].color_bounds_min[DEPTH_CUR];
+	}
+	return slack;
+}
+
+/* Once a clue was swept, the cells up to the end of the sets that have a
+single position left from the start of the line are locked, and no change
+elsewhere in the line can alter their part of the sweep. The sweep starts
+after them, pos is set to the position where the next set may begin. */
+static int get_fixed_sets_n(const clue_t *clue, int *pos) {
+	int i;
+	for (i = 0; i < clue->sets_n && clue->sets[i].color_bounds_min[DEPTH_CUR] == clue->sets[i].color_bounds_max[DEPTH_CUR]; ++i) {
+		*pos = clue->sets[i].color_bounds_min[DEPTH_CUR]+clue->sets[i].empty_before+clue->sets[i].len;
+	}
+	return i;
+}
+
+/* Line solver for black and white puzzles, the row/column is packed into
+bitsets indexed by position (bit n is the position after the last cell). A
+forward pass from each side computes the positions reachable by the sets
+placed before, the intersection gives the exact feasible start positions of
+each set and the possible colors of each cell. */
+static int sweep_line_bits(nonogram_t *ctx, clue_t *clue, cell_t *start_cell, int n) {
+	int k = clue->sets_n, unique = 1, i;
+	bits_t empty = 0, filled = 0, empty_rev, filled_rev, empty_ok = 0, filled_ok = 0, *reached = ctx->line_bits, *reached_rev = reached+k+1, *starts = reached_rev+k+1, *starts_rev = starts+k;
+	cell_t *cell;
+	for (i = 0, cell = start_cell; i < n; ++i, cell += ctx->offset) {
+		empty |= (bits_t)(cell->colors & 1) << i;
+		filled |= (bits_t)(cell->colors >> 1 & 1) << i;
+	}
+	empty_rev = reverse_bits(empty, n-1);
+	filled_rev = reverse_bits(filled, n-1);
+	for (i = 0; i < k; ++i) {
+		set_t *set = clue->sets+i;
+		int j;
+		starts[i] = 0;
+		for (j = set->color_bounds_min[DEPTH_CUR]; j <= set->color_bounds_max[DEPTH_CUR]; ++j) {
+			starts[i] |= (bits_t)(set->color_cache[j-set->color_bounds_min[DEPTH_BCK]] >= CACHE_UNKNOWN) << (j+set->empty_before);
+		}
+		starts_rev[k-1-i] = reverse_bits(starts[i], n) >> set->len;
+	}
+	if (!reach_line_bits(n, k, clue->sets, 1, empty, filled, reached, starts) || !reach_line_bits(n, k, clue->sets+k-1, -1, empty_rev, filled_rev, reached_rev, starts_rev)) {
+		return ctx->negative_cache;
+	}
+	for (i = 0; i <= k; ++i) {
+
+		/* The positions from which the sets i and after may be placed, the
+		empty cells before set i must be followed by such a position. */
+		bits_t suffix = reverse_bits(reached_rev[k-i], n), gap = empty & suffix >> 1;
+		empty_ok |= reached[i] & gap;
+		if (i) {
+			set_t *set = clue->sets+i-1;
+			int skipped = 0, j;
+			bits_t feasible = starts[i-1] & (i < k ? gap:suffix) >> set->len, fit = fit_bits(filled, set->len), visited = close_bits(i > 1 ? starts[i-2] << clue->sets[i-2].len:1, empty);
+			if (feasible & (feasible-1)) {
+				unique = 0;
+			}
+
+			/* Like the generic sweep, only the positions reached after the
+			sets before (visited) or skipped are marked infeasible, the others
+			are left unknown. The positions following a visited one whose set
+			is cut by an empty cell are skipped up to that cell. */
+			for (j = set->color_bounds_min[DEPTH_CUR]; j <= set->color_bounds_max[DEPTH_CUR]; ++j) {
+				int pos = j+set->empty_before, *cache = set->color_cache+j-set->color_bounds_min[DEPTH_BCK];
+				if (skipped && !(filled >> (pos-1) & 1)) {
+					skipped = 0;
+				}
+				if (*cache == CACHE_UNKNOWN) {
+					if (feasible >> pos & 1) {
+						*cache = CACHE_CONFIRMED;
+					}
+					else if (visited >> j & 1 || skipped) {
+						*cache = ctx->negative_cache;
+					}
+					if (visited >> j & 1 && (!set->empty_before || empty >> j & 1) && (filled & ~fit) >> pos & 1) {
+						skipped = 1;
+					}
+				}
+			}
+			filled_ok |= dilate_bits(feasible, set->len);
+		}
+	}
+
+	/* The possible colors are a subset of the allowed ones, so they may be
+	confirmed without branching. */
+	for (i = 0, cell = start_cell; i < n; ++i, cell += ctx->offset) {
+		cell->confirmed |= (uint64_t)(empty_ok >> i & 1) | (uint64_t)(filled_ok >> i & 1) << 1;
+	}
+	return unique ? 1:2;
+}
+
+/* reached[i] receives the positions where the empty cells before set i may
+end, starts[i] is reduced from the allowed start positions of set i to those
+compatible with the sets before. Returns 0 if the line is infeasible. */
+static int reach_line_bits(int n, int k, const set_t *set, int step, bits_t empty, bits_t filled, bits_t *reached, bits_t *starts) {
+	int i;
+	bits_t ends = 1;
+	reached[0] = close_bits(ends, empty);
+	for (i = 0; i < k; ++i, set += step) {
+		if (i) {
+			reached[i] = close_bits((ends & empty) << 1, empty);
+		}
+		starts[i] &= reached[i] & fit_bits(filled, set->len);
+		if (!starts[i]) {
+			return 0;
+		}
+		if (i) {
+			reached[i] |= ends;
+		}
+		ends = starts[i] << set->len;
+	}
+	if (k) {
+		reached[k] = close_bits(ends, empty);
+	}
+	return reached[k] >> n & 1;
+}
+
+/* Adds to the source the positions reachable from it through empty cells, the
+carry of the addition runs along each block of empty cells. */
+static bits_t close_bits(bits_t source, bits_t empty) {
+	return source | ((empty+(source & empty)) ^ empty);
+}
+
+/* Keeps the positions where len filled cells may follow. */
+static bits_t fit_bits(bits_t filled, int len) {
+	int shift;
+	for (shift = 1; shift*2 <= len; shift *= 2) {
+		filled &= filled >> shift;
+	}
+	if (shift < len) {
+		filled &= filled >> (len-shift);
+	}
+	return filled;
+}
+
+/* Extends each start position to the len cells covered by the set. */
+static bits_t dilate_bits(bits_t starts, int len) {
+	int shift;
+	for (shift = 1; shift*2 <= len; shift *= 2) {
+		starts |= starts << shift;
+	}
+	if (shift < len) {
+		starts |= starts << (len-shift);
+	}
+	return starts;
+}
+
+/* Maps position i to position n-i. */
+static bits_t reverse_bits(bits_t bits, int n) {
+	return ((bits_t)reverse_word((uint64_t)bits) << 64 | reverse_word((uint64_t)(bits >> 64))) >> (LINE_BITS_MAX-n);
+}
+
+static uint64_t reverse_word(uint64_t word) {
+	word = (word >> 1 & UINT64_C(0x5555555555555555)) | (word & UINT64_C(0x5555555555555555)) << 1;
+	word = (word >> 2 & UINT64_C(0x3333333333333333)) | (word & UINT64_C(0x3333333333333333)) << 2;
+	word = (word >> 4 & UINT64_C(0x0f0f0f0f0f0f0f0f)) | (word & UINT64_C(0x0f0f0f0f0f0f0f0f)) << 4;
+	return __builtin_bswap64(word);
+}
+
+/* The trail capacity is doubled when exceeded. */
+static int reserve_trail(nonogram_t *ctx, int trail_size) {
+	trail_t *trail;
+	if (trail_size < ctx->trail_size*2) {
+		trail_size = ctx->trail_size*2;
+	}
+	trail = realloc_mem("trail", ctx->trail, sizeof(trail_t), trail_size);
+	if (!trail) {
+		return 0;
+	}
+	add_memory(ctx, sizeof(trail_t)*(size_t)(trail_size-ctx->trail_size));
+	ctx->trail = trail;
+	ctx->trail_size = trail_size;
+	return 1;
+}
+
+/* The colors allowed but not confirmed by the last sweep are removed. */
+static int check_cell_colors(nonogram_t *ctx, cell_t *cell) {
+	int changes_n, color_pos;
+	uint64_t confirmed = cell->confirmed, removed = cell->colors & ~confirmed;
+	if (removed) {
+		ctx->trail[ctx->trail_n].cell = cell;
+		ctx->trail[ctx->trail_n++].colors = cell->colors;
+		if (ctx->table) {
+			ctx->hash ^= hash_cell(ctx, cell, cell->colors)^hash_cell(ctx, cell, confirmed);
+		}
+		cell->colors = confirmed;
+	}
+	cell->confirmed = 0;
+	changes_n = __builtin_popcountll(removed);
+	if (changes_n) {
+		if (cell->column_clue != ctx->current_clue) {
+			push_clue(ctx, cell->column_clue, changes_n);
+		}
+		if (cell->row_clue != ctx->current_clue) {
+			push_clue(ctx, cell->row_clue, changes_n);
+		}
+	}
+	if (!confirmed) {
+		color_pos = COLOR_POS_UNKNOWN;
+	}
+	else if (confirmed & (confirmed-1)) {
+		color_pos = COLOR_POS_SEVERAL;
+	}
+	else {
+		color_pos = COLOR_POS_EMPTY+__builtin_ctzll(confirmed);
+	}
+	if (color_pos > COLOR_POS_SEVERAL) {
+		cell->color_pos = color_pos;
+		cell->column_last->column_next = cell->column_next;
+		cell->column_next->column_last = cell->column_last;
+		cell->row_last->row_next = cell->row_next;
+		cell->row_next->row_last = cell->row_last;
+		ctx->locked_cells[ctx->locked_cells_n++] = cell;
+	}
+	return changes_n;
+}
+
+static void update_empty_bound_and_cache(int *bounds_min, const int *bounds_max, int *cache) {
+	for (; bounds_min[DEPTH_CUR] <= bounds_max[DEPTH_CUR] && cache[bounds_min[DEPTH_CUR]-bounds_min[DEPTH_BCK]] <= CACHE_UNKNOWN; ++bounds_min[DEPTH_CUR]);
+	clear_set_positive_cache(bounds_min, bounds_max, cache);
+}
+
+static void update_color_bounds_and_cache(int *bounds_min, int *bounds_max, int *cache) {
+	for (; bounds_min[DEPTH_CUR] <= bounds_max[DEPTH_CUR] && cache[bounds_min[DEPTH_CUR]-bounds_min[DEPTH_BCK]] <= CACHE_UNKNOWN; ++bounds_min[DEPTH_CUR]);
+	for (; bounds_max[DEPTH_CUR] >= bounds_min[DEPTH_CUR] && cache[bounds_max[DEPTH_CUR]-bounds_min[DEPTH_BCK]] <= CACHE_UNKNOWN; --bounds_max[DEPTH_CUR]);
+	clear_set_positive_cache(bounds_min, bounds_max, cache);
+}
+
+static void clear_set_positive_cache(const int *bounds_min, const int *bounds_max, int *cache) {
+	int i;
+	for (i = bounds_min[DEPTH_CUR]; i <= bounds_max[DEPTH_CUR]; ++i) {
+		if (cache[i-bounds_min[DEPTH_BCK]] > CACHE_UNKNOWN) {
+			cache[i-bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+		}
+	}
+}
+
+static int compare_sets(const void *a, const void *b) {
+	int r;
+	set_t *set_a = *(set_t * const *)a, *set_b = *(set_t * const *)b;
+	r = compare_evaluations(set_a, set_b);
+	if (r) {
+		return r;
+	}
+	if (set_a->clue->failures != set_b->clue->failures) {
+		return set_a->clue->failures > set_b->clue->failures ? -1:1;
+	}
+	if (set_a->tie != set_b->tie) {
+		return set_a->tie < set_b->tie ? -1:1;
+	}
+	if (set_a->clue != set_b->clue) {
+		return set_a->clue->pos-set_b->clue->pos;
+	}
+	return (int)(set_a-set_b);
+}
+
+static int evaluate_set(nonogram_t *ctx, set_t *set) {
+	int options_n = set->options_n, i;
+	uint64_t phase_start = ctx->profile ? get_clock_ns():0;
+	save_clue(ctx, set->clue);
+	memset(set->swept_clues, 0, sizeof(uint64_t)*(size_t)ctx->clue_words_n);
+	ctx->swept_clues = set->swept_clues;
+	for (i = options_n; i--; ) {
+		set->color_cache[set->options[i].pos-set->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+	}
+	set->options_n = 0;
+	set->solutions_n = 0;
+	set->changes_sum = 0;
+	set->skipped = 0;
+	i = 0;
+	do {
+		int j, lo, hi;
+		for (j = i+1; j < options_n; ++j) {
+			if (set->options[j-1].pos+1 < set->options[j].pos) {
+				break;
+			}
+		}
+		for (lo = i; lo < j; ++lo) {
+			evaluate_option(ctx, set, set->options+lo);
+			if (set->options[lo].r >= 0) {
+				break;
+			}
+		}
+		for (hi = j-1; hi > lo; --hi) {
+			evaluate_option(ctx, set, set->options+hi);
+			if (set->options[hi].r >= 0) {
+				break;
+			}
+		}
+		for (--hi; hi > lo; --hi) {
+			init_option(set->options+hi, 0, 0);
+			++set->skipped;
+		}
+		i = j;
+	}
+	while (i < options_n);
+	for (i = 0; i < options_n; ++i) {
+		if (set->options[i].r >= 0) {
+			set->color_cache[set->options[i].pos-set->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+			set->options[set->options_n++] = set->options[i];
+		}
+		else if (ctx->table) {
+			ctx->hash ^= hash_option(set, set->options[i].pos, HASH_MARK);
+		}
+	}
+	set->others_n = set->options_n-set->solutions_n;
+
+	/* The options that lead to a solution give distinct grids. */
+	if (ctx->unique) {
+		if (set->solutions_n > 1) {
+			report_multiple(ctx);
+		}
+		set->solutions_n = 0;
+	}
+	ctx->swept_clues = NULL;
+	if (set->options_n < options_n) {
+		set->clue->removed = ++ctx->probes_stamp;
+	}
+	set->probed = ++ctx->probes_stamp;
+	if (ctx->profile) {
+		add_phase(ctx, PHASE_PROBE, phase_start);
+	}
+	return options_n-set->options_n;
+}
+
+/* The evaluated node does not branch, its frame is not kept. With the table,
+the clues swept by the probe are gathered apart to be kept with its result. */
+static void evaluate_option(nonogram_t *ctx, set_t *set, option_t *option) {
+	int i;
+	frame_t frame;
+	set->color_cache[option->pos-set->color_bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+	++ctx->node_probes_n;
+	++ctx->depth;
+	--ctx->negative_cache;
+	if (ctx->table) {
+		ctx->probe_key = ctx->table_seed^ctx->hash^hash_option(set, option->pos, HASH_PROBE);
+		memset(ctx->probe_clues, 0, sizeof(uint64_t)*(size_t)ctx->clue_words_n);
+		ctx->swept_clues = ctx->probe_clues;
+	}
+	sweep_node(ctx, set->clue, option, &frame);
+	leave_node(ctx, &frame);
+	if (ctx->table) {
+		for (i = 0; i < ctx->clue_words_n; ++i) {
+			set->swept_clues[i] |= ctx->probe_clues[i];
+		}
+		ctx->swept_clues = set->swept_clues;
+	}
+	++ctx->negative_cache;
+	--ctx->depth;
+	set->color_cache[option->pos-set->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+	if (option->r >= 0) {
+		set->solutions_n += option->r;
+		set->changes_sum += option->changes_sum;
+	}
+}
+
+/* Rules out the option at the node like a failed probe. */
+static void remove_option(nonogram_t *ctx, set_t *set, int pos) {
+	save_clue(ctx, set->clue);
+	set->color_cache[pos-set->color_bounds_min[DEPTH_BCK]] = ctx->negative_cache;
+	set->clue->removed = ++ctx->probes_stamp;
+	if (ctx->table) {
+		ctx->hash ^= hash_option(set, pos, HASH_MARK);
+	}
+}
+
+static set_t *init_set_min(nonogram_t *ctx, set_t *set) {
+	if (ctx->trace) {
+		fprintf(ctx->trace, "set_min %d %d %d %d\n", set->others_n, set->skipped, set->solutions_n, set->changes_sum);
+		fflush(ctx->trace);
+	}
+	return set;
+}
+
+/* The probes of a set only depend on the clues they swept, its evaluation is
+kept at the node until one of them loses options. */
+static int check_set_stale(const nonogram_t *ctx, const set_t *set) {
+	int i;
+	if (!set->probed) {
+		return 1;
+	}
+	for (i = 0; i < ctx->clue_words_n; ++i) {
+		uint64_t word;
+		for (word = set->swept_clues[i]; word; word &= word-1) {
+			if (ctx->clues[i*64+__builtin_ctzll(word)].removed > set->probed) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int compare_evaluations(const set_t *set_a, const set_t *set_b) {
+	if (set_a->others_n != set_b->others_n) {
+		return set_a->others_n-set_b->others_n;
+	}
+	if (set_a->skipped != set_b->skipped) {
+		return set_a->skipped-set_b->skipped;
+	}
+	if (set_a->solutions_n != set_b->solutions_n) {
+		return set_b->solutions_n-set_a->solutions_n;
+	}
+	return set_b->changes_sum-set_a->changes_sum;
+}
+
+static int compare_options(const void *a, const void *b) {
+	const option_t *option_a = (const option_t *)a, *option_b = (const option_t *)b;
+	if (option_a->r != option_b->r) {
+		return option_a->r-option_b->r;
+	}
+	if (option_a->changes_sum != option_b->changes_sum) {
+		return option_a->changes_sum-option_b->changes_sum;
+	}
+	if (option_a->tie != option_b->tie) {
+		return option_a->tie < option_b->tie ? -1:1;
+	}
+	return option_b->pos-option_a->pos;
+}
+
+static void uncover_set(set_t *set) {
+	set->next->last = set;
+	set->last->next = set;
+}
+
+static void uncover_clue(clue_t *clue) {
+	clue->next->last = clue;
+	clue->last->next = clue;
+}
+
+static void uncover_cell(cell_t *cell) {
+	cell->row_next->row_last = cell;
+	cell->row_last->row_next = cell;
+	cell->column_next->column_last = cell;
+	cell->column_last->column_next = cell;
+	cell->confirmed = 0;
+	cell->color_pos = COLOR_POS_UNKNOWN;
+}
+
+/* The hash of a node is kept up to date as colors are removed from the cells,
+clues are solved and options are ruled out, and is put back from the frame
+when the node is left. Together these decide the results of the probes. */
+static uint64_t hash_cell(const nonogram_t *ctx, const cell_t *cell, uint64_t colors) {
+	return mix_hash(mix_hash((uint64_t)(cell-ctx->cells)*HASH_CELL)^colors);
+}
+
+static uint64_t hash_option(const set_t *set, int pos, uint64_t salt) {
+	return mix_hash(((uint64_t)set->clue->pos << 40 ^ (uint64_t)(set-set->clue->sets) << 20 ^ (uint64_t)pos)*salt);
+}
+
+/* Finalizer of splitmix64. */
+static uint64_t mix_hash(uint64_t hash) {
+	hash = (hash^(hash >> 30))*UINT64_C(0xbf58476d1ce4e5b9);
+	hash = (hash^(hash >> 27))*UINT64_C(0x94d049bb133111eb);
+	return hash^(hash >> 31);
+}
+
+static void clear_set_negative_cache(nonogram_t *ctx, const int *bounds_min, const int *bounds_max, int *cache) {
+	int i;
+	for (i = bounds_min[ctx->depth+DEPTH_BCK]; i <= bounds_max[ctx->depth+DEPTH_BCK]; ++i) {
+		if (cache[i-bounds_min[DEPTH_BCK]] == ctx->negative_cache) {
+			cache[i-bounds_min[DEPTH_BCK]] = CACHE_UNKNOWN;
+		}
+	}
+}
+
+static void init_empty_bounds(set_t *set, int pos, int bound_min) {
+	set->empty_bounds_min[pos] = bound_min;
+}
+
+static void init_color_bounds(set_t *set, int pos, int bound_min, int bound_max) {
+	set->color_bounds_min[pos] = bound_min;
+	set->color_bounds_max[pos] = bound_max;
+}
+
+static int sum_with_limit(int a, int b) {
+	if (a <= INT_MAX-b) {
+		return a+b;
+	}
+	return INT_MAX;
+}
+
+static void *alloc_mem(const char *name, size_t item_size, int items_n) {
+	void *mem = malloc(item_size*(size_t)items_n);
+	if (!mem) {
+		fprintf(stderr, "Could not allocate memory for %s\n", name);
+		fflush(stderr);
+	}
+	return mem;
+}
+
+static void *realloc_mem(const char *name, void *mem, size_t item_size, int items_n) {
+	void *reem = realloc(mem, item_size*(size_t)items_n);
+	if (!reem) {
+		fprintf(stderr, "Could not reallocate memory for %s\n", name);
+		fflush(stderr);
+	}
+	return reem;
+}
+
+static void free_data(nonogram_t *ctx) {
+	free(ctx->table);
+	free(ctx->table_clues);
+	free(ctx->nogoods);
+	free(ctx->buckets);
+	free(ctx->placements);
+	if (ctx->checker) {
+		nonogram_destroy(ctx->checker);
+	}
+	free(ctx->frames);
+	ctx->frames = NULL;
+	free(ctx->locked_cells);
+	ctx->locked_cells = NULL;
+	free(ctx->locked_clues);
+	ctx->locked_clues = NULL;
+	free(ctx->queued_clues);
+	ctx->queued_clues = NULL;
+	free(ctx->locked_sets);
+	ctx->locked_sets = NULL;
+	free(ctx->sorted_sets);
+	ctx->sorted_sets = NULL;
+	free(ctx->cells);
+	ctx->cells = NULL;
+	if (ctx->clues) {
+		int i;
+		for (i = ctx->clues_size; i--; ) {
+			free(ctx->clues[i].bounds);
+			free(ctx->clues[i].sets);
+		}
+		free(ctx->clues);
+	}
+	free(ctx->saved_clues);
+	free(ctx->trail);
+	free(ctx->arena);
+	free(ctx->grid);
+	free(ctx->colors);
+	free(ctx->text);
+	init_data(ctx);
+}
+
+static void free_ints(int **ints) {
+	if (*ints) {
+		free(*ints);
+		*ints = NULL;
+	}
+}
@@ -0,0 +1,180 @@
+#ifndef NONOGRAM_SOLVER_H
+#define NONOGRAM_SOLVER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define NONOGRAM_ABORT_NONE 0
+#define NONOGRAM_ABORT_NODES 1
+#define NONOGRAM_ABORT_TIME 2
+#define NONOGRAM_ABORT_MEMORY 3
+
+#define NONOGRAM_STRATEGY_PROBE 0
+#define NONOGRAM_STRATEGY_FEWEST 1
+#define NONOGRAM_STRATEGY_TOP 2
+#define NONOGRAM_STRATEGY_ADAPTIVE 3
+
+/* A pack of puzzles starts with the magic, the number of puzzles on 4 bytes
+and the offset of the index on 8 bytes. The index holds the offsets of the
+records followed by the end of the last one, on 8 bytes each. A record is
+the puzzle name ended by a null character followed by the puzzle written by
+nonogram_encode. The fixed size integers are little endian. */
+#define NONOGRAM_PACK_MAGIC "NGP1"
+#define NONOGRAM_PACK_HEADER_SIZE 16
+
+typedef struct nonogram_s nonogram_t;
+
+typedef struct {
+	double time;
+	uint64_t all_nodes_n;
+	uint64_t run_nodes_n;
+	uint64_t failures_n;
+
+	/* Number of run nodes whose line sweeps failed, the failures only count
+	the sets left without options. */
+	uint64_t sweep_failures_n;
+	int depth;
+	int max_depth;
+	int completed_depth;
+	int cells_n;
+	unsigned locked_cells_n;
+	unsigned long solutions_n;
+	int aborted;
+	uint64_t table_hits_n;
+	uint64_t table_misses_n;
+
+	/* Member of the portfolio that answered first (0 without portfolio) and
+	its strategy. */
+	int winner;
+	int strategy;
+
+	/* Seed of the search that gave the statistics and number of restarts. */
+	uint64_t seed;
+	int restarts_n;
+
+	/* Number of nogoods learned and of options they ruled out. */
+	uint64_t nogoods_n;
+	uint64_t nogood_hits_n;
+}
+nonogram_stats_t;
+
+/* Called for each solution with the grid as width*height color symbols in row
+order, the search stops when it returns 0. With several workers it is called
+from the worker threads, one call at a time and in sequential order. */
+typedef int (*nonogram_callback_t)(void *, const nonogram_stats_t *, const char *);
+
+typedef struct {
+	unsigned long solutions_max;
+
+	/* Only tells whether the puzzle has no, one or several solutions: the
+	search stops at the second solution, including one proved by the probes
+	when two options of the same set lead to a solution, solutions_max is
+	ignored and the callback is not called. The number of solutions of the
+	probes is then not a criterion to choose the set to branch on. */
+	int unique;
+
+	/* Budget of the search, it stops at the first node over one of the limits
+	(the nodes and memory of all the workers are summed). The time is in
+	seconds and the memory in bytes, 0 means no limit for both. */
+	uint64_t nodes_max;
+	double time_max;
+	size_t memory_max;
+
+	/* Size in bytes of the table of probe results, shared out between the
+	workers and the portfolio members, 0 to disable it. */
+	size_t table_size;
+
+	/* Choice of the set to branch on: probe all the sets, take the set with
+	the fewest options without probing, probe the probes_max sets with the
+	fewest options, or probe a number of sets halved or doubled depending on
+	whether the probes at the previous node removed options. */
+	int strategy;
+	int probes_max;
+
+	/* Maximum number of options probed at each node, 0 means no limit. A set
+	is only probed again at a node when one of the clues swept by its last
+	probes lost options since, the other sets keep their evaluation. */
+	int probes_budget;
+	int workers_n;
+
+	/* Number of searches raced on separate threads, the first that completes
+	gives the answer and stops the others. Member 0 uses the options above,
+	member N goes through the other strategies and breaks the ties between
+	sets in an order drawn from the seed plus N. The node and memory limits
+	apply to each member. */
+	int portfolio_n;
+
+	/* The ties between sets or options of the same evaluation are broken in
+	an order drawn from the seed, 0 keeps the order of the clues and positions.
+	When restart_nodes is not 0, the search restarts from the root with a new
+	order after restart_nodes run nodes times the Luby sequence, until the
+	first solution is found. The sets of the clues that failed most often are
+	then preferred. */
+	uint64_t seed;
+	uint64_t restart_nodes;
+
+	/* Maximum number of nogoods kept, 0 disables the learning. A nogood is a
+	set of placements that cannot all hold in a solution, learned from a failed
+	node by keeping only the placements branched on above it that the failure
+	needs. The options of a node that complete a nogood are ruled out before
+	the probes. The least recently used nogood is replaced when the store is
+	full. Each failed node is replayed from the root up to 20 times, which can
+	take more time than the nodes it saves. Needs a single worker and no
+	checkpoint. */
+	int nogoods_max;
+	FILE *trace;
+
+	/* Receives the time spent and number of calls for each phase of the
+	search at the end of nonogram_solve when not NULL. */
+	FILE *profile;
+
+	/* The search state is written to the checkpoint file every period of
+	seconds, and read from the resume file to continue the search where it
+	was saved, when not NULL. Both need a single worker. */
+	const char *checkpoint;
+	double checkpoint_period;
+	const char *resume;
+}
+nonogram_options_t;
+
+void nonogram_init_options(nonogram_options_t *);
+
+/* Returns NULL if the solver could not be allocated. */
+nonogram_t *nonogram_create(void);
+
+/* Reads one puzzle in text format, returns 0 if it is invalid. */
+int nonogram_load(nonogram_t *, FILE *);
+
+/* Same as nonogram_load for a puzzle at the start of a block of memory of
+the given size, the number of bytes read is stored in the last argument so
+that a next puzzle may be parsed after it. The errors are printed with their
+line and column in the block. */
+int nonogram_parse(nonogram_t *, const char *, size_t, size_t *);
+
+/* Writes the loaded puzzle as a binary record in the buffer of the given
+size, returns the size of the record (0 if no puzzle is loaded). The record
+is only complete when its size is not over the size of the buffer. */
+size_t nonogram_encode(const nonogram_t *, unsigned char *, size_t);
+
+/* Loads a puzzle from a record written by nonogram_encode, returns 0 if it is
+invalid. */
+int nonogram_decode(nonogram_t *, const unsigned char *, size_t);
+
+int nonogram_width(const nonogram_t *);
+int nonogram_height(const nonogram_t *);
+
+/* Returns the number of colors including empty. */
+int nonogram_colors(const nonogram_t *);
+
+/* Searches the loaded puzzle, returns 0 on error. The final statistics are
+stored in the last argument, the aborted field is the reason why the search
+went over its budget. */
+int nonogram_solve(nonogram_t *, const nonogram_options_t *, nonogram_callback_t, void *, nonogram_stats_t *);
+
+/* Returns the grid of the node where the last search was aborted in the same
+format as the callback, NULL if it was not aborted. */
+const char *nonogram_partial_grid(const nonogram_t *);
+
+void nonogram_destroy(nonogram_t *);
+
+#endif